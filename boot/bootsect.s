@@ -7,10 +7,10 @@
 # rewrite with AT&T syntax by falcon <wuzhangjin@gmail.com> at 081012
 #
 # SYS_SIZE is the number of clicks (16 bytes) to be loaded.
-# 0x3000 is 0x30000 bytes = 196kB, more than enough for current
+# 0x4000 is 0x40000 bytes = 256kB, more than enough for current
 # versions of linux
 #
-	.equ SYSSIZE, 0x3000
+	.equ SYSSIZE, 0x4000
 #
 #	bootsect.s		(C) 1991 Linus Torvalds
 #
@@ -51,6 +51,9 @@
 ##和源码不同，源码中是0x306 第2块硬盘的第一个分区
 #
 	.equ ROOT_DEV, 0x301
+# SCHED_CLASS:	0 - counter scheduler
+#		1 - fair scheduler (kernel/sched_fair.c)
+	.equ SCHED_CLASS, 0
 	ljmp    $BOOTSEG, $_start
 _start:
 	mov	$BOOTSEG, %ax	#将ds段寄存器设置为0x7C0
@@ -263,7 +266,9 @@ msg1:
 	.ascii "IceCityOS is booting ..."
 	.byte 13,10,13,10
 
-	.org 508
+	.org 506
+sched_class:
+	.word SCHED_CLASS
 root_dev:
 	.word ROOT_DEV
 boot_flag:
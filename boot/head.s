@@ -17,7 +17,8 @@
  加载内核运行时的各数据段，重新设置
  */
 .text
-.globl idt,gdt,pg_dir,tmp_floppy_area
+.globl idt,gdt,pg_dir,tmp_floppy_area,cpu_features
+.globl idt_descr
 pg_dir:
 .globl startup_32
 startup_32:
@@ -53,6 +54,7 @@ startup_32:
 	orl $2,%eax		# set MP
 	movl %eax,%cr0
 	call check_x87
+	call check_cpuid
 	jmp after_page_tables
 
 /*
@@ -71,6 +73,34 @@ check_x87:
 1:	.byte 0xDB,0xE4		/* fsetpm for 287, ignored by 387 */
 	ret
 
+/*
+ * Get the cpuid feature flags into cpu_features, if the cpu knows about
+ * cpuid at all: that's the case if we can flip the ID bit in eflags.
+ * Older ones are left with 0, ie no large pages etc. Early Pentium Pros
+ * claim to have sysenter, but don't.
+ */
+check_cpuid:
+	pushfl
+	popl %eax
+	movl %eax,%ecx
+	xorl $0x200000,%eax	/* ID bit */
+	pushl %eax
+	popfl
+	pushfl
+	popl %eax
+	pushl %ecx		/* restore eflags */
+	popfl
+	xorl %ecx,%eax
+	je 1f
+	movl $1,%eax
+	cpuid
+	andl $0xfff,%eax	/* family, model, stepping */
+	cmpl $0x633,%eax
+	jae 2f
+	andl $~0x800,%edx	/* no SEP */
+2:	movl %edx,cpu_features
+1:	ret
+
 /*
  *  setup_idt
  *
@@ -115,8 +145,8 @@ setup_gdt:
 
 /*
  * I put the kernel page tables right after the page directory,
- * using 4 of them to span 16 Mb of physical memory. People with
- * more than 16MB will have to expand this.
+ * using 4 of them to span 16 Mb of physical memory. Memory above
+ * that is mapped by paging_init() in mm/memory.c.
  */
 .org 0x1000
 pg0:
@@ -139,6 +169,10 @@ pg3:
 tmp_floppy_area:
 	.fill 1024,1,0
 
+/* cpuid level 1 edx, see check_cpuid and <linux/head.h> */
+cpu_features:
+	.long 0
+
 after_page_tables:
 	pushl $0		# These are the parameters to main :-)
 	pushl $0
@@ -192,14 +226,16 @@ ignore_int:
  * will be mapped to some other place - mm keeps track of
  * that.
  *
- * For those with more memory than 16 Mb - tough luck. I've
- * not got it, why should you :-) The source is here. Change
- * it. (Seriously - it shouldn't be too difficult. Mostly
- * change some constants etc. I left it at 16Mb, as my machine
- * even cannot be extended past that (ok, but it was cheap :-)
- * I've tried to show which constants to change by having
- * some kind of marker at them (search for "16Mb"), but I
- * won't guarantee that's all :-( )
+ * More than 16 Mb is handled later by paging_init(), which
+ * takes the page tables it needs from main memory: this
+ * page directory is the kernel half of all the others, and
+ * maps up to 1Gb of physical memory.
+ *
+ * If the cpu has large pages (PSE) we don't use pg0-pg3 at
+ * all, but map the 16Mb with four 4Mb pages, which saves a
+ * lot of tlb entries. They are made global (PGE) when that
+ * is supported too, so they survive the cr3 reload of a task
+ * switch. Nobody ever changes these mappings after this.
  */
 .align 2
 setup_paging:
@@ -207,6 +243,8 @@ setup_paging:
 	xorl %eax,%eax
 	xorl %edi,%edi			/* pg_dir is at 0x000 */
 	cld;rep;stosl
+	testl $0x08,cpu_features	/* PSE? */
+	jne 2f
 	movl $pg0+7,pg_dir		/* set present bit/user r/w */
 	movl $pg1+7,pg_dir+4		/*  --------- " " --------- */
 	movl $pg2+7,pg_dir+8		/*  --------- " " --------- */
@@ -218,7 +256,25 @@ setup_paging:
 	subl $0x1000,%eax
 	jge 1b
 	cld
-	xorl %eax,%eax		/* pg_dir is at 0x0000 */
+	jmp 4f
+2:	movl %cr4,%eax
+	orl $0x10,%eax			/* cr4.PSE */
+	movl %eax,%cr4
+	movl $0x87,%eax			/* 4Mb page, r/w user, p */
+	testl $0x2000,cpu_features	/* PGE? */
+	je 3f
+	movl %cr4,%edx
+	orl $0x80,%edx			/* cr4.PGE */
+	movl %edx,%cr4
+	orl $0x100,%eax			/* global */
+3:	movl %eax,pg_dir
+	addl $0x400000,%eax
+	movl %eax,pg_dir+4
+	addl $0x400000,%eax
+	movl %eax,pg_dir+8
+	addl $0x400000,%eax
+	movl %eax,pg_dir+12
+4:	xorl %eax,%eax		/* pg_dir is at 0x0000 */
 	movl %eax,%cr3		/* cr3 - page directory start */
 	movl %cr0,%eax
 	orl $0x80000000,%eax
@@ -240,7 +296,9 @@ gdt_descr:
 idt:	.fill 256,8,0		# idt is uninitialized
 
 gdt:	.quad 0x0000000000000000	/* NULL descriptor */
-	.quad 0x00c09a0000000fff	/* 16Mb */
-	.quad 0x00c0920000000fff	/* 16Mb */
+	.quad 0x00cf9a000000ffff	/* 4Gb */
+	.quad 0x00cf92000000ffff	/* 4Gb */
 	.quad 0x0000000000000000	/* TEMPORARY - don't use */
 	.fill 252,8,0			/* space for LDT's and TSS's etc */
+
+.section .note.GNU-stack,"",@progbits
@@ -65,6 +65,25 @@ _start:
 	int	$0x15
 	mov	%ax, %ds:2
 
+# Get memory size above 16M as well (e801), in kB at 0x901E0. The
+# call above can't report more than 64M.
+
+	movl	$0, %ds:0x1e0
+	mov	$0xe801, %ax
+	xor	%cx, %cx
+	xor	%dx, %dx
+	int	$0x15
+	jc	no_e801
+	jcxz	1f		# some bioses only return ax/bx
+	mov	%cx, %ax
+	mov	%dx, %bx
+1:	movzwl	%bx, %edx	# 64k blocks above 16M
+	shll	$6, %edx
+	movzwl	%ax, %eax	# kB between 1M and 16M
+	addl	%eax, %edx
+	movl	%edx, %ds:0x1e0
+no_e801:
+
 # Get video-card data:
 
 	mov	$0x0f, %ah
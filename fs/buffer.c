@@ -25,6 +25,7 @@
 #include <linux/config.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/trace.h>
 #include <asm/system.h>
 #include <asm/io.h>
 
@@ -36,17 +37,19 @@ struct buffer_head * start_buffer = (struct buffer_head *) &end;
 // hash 结构 
 struct buffer_head * hash_table[NR_HASH];
 static struct buffer_head * free_list;
-static struct task_struct * buffer_wait = NULL;
+static struct wait_queue * buffer_wait = NULL;
 int NR_BUFFERS = 0;
+/* b_lock, and sleeping on b_wait for it: see ll_rw_blk.c and blk.h */
+spinlock_t buffer_lock = SPIN_LOCK_UNLOCKED;
 
 static inline void wait_on_buffer(struct buffer_head * bh)
 {
-	// 等待解锁
-	cli(); // 中断 挂起
-	while (bh->b_lock) // 有锁定
-	    // 在b_wait链表上一直等待，没有锁定解开。
-		sleep_on(&bh->b_wait);
-	sti(); // 关闭中断
+	unsigned long flags;
+
+	spin_lock_irqsave(&buffer_lock,flags);
+	while (bh->b_lock)
+		sleep_on_unlock(&bh->b_wait,&buffer_lock);
+	spin_unlock_irqrestore(&buffer_lock,flags);
 }
 
 int sys_sync(void)
@@ -232,8 +235,10 @@ struct buffer_head * getblk(int dev,int block)
 
 repeat:
     // 获取 在哈希表中 直接返回，在有效高速缓冲区中
-	if ((bh = get_hash_table(dev,block)))
+	if ((bh = get_hash_table(dev,block))) {
+		tracepoint(TR_GETBLK_HIT,dev,block);
 		return bh;
+	}
 	// 搜素空闲缓冲队列 寻找合适块
 	tmp = free_list;
 	do {
@@ -249,7 +254,7 @@ repeat:
 	} while ((tmp = tmp->b_next_free) != free_list);
 	if (!bh) {
 		// 寻找不到合适的块休眠 进入sleep队列 进行等待
-		sleep_on(&buffer_wait);
+		sleep_on_exclusive(&buffer_wait);
 		goto repeat;
 	}
 	// 多线程过程中 资源被锁定 等待解锁 临界内存区域方法
@@ -285,6 +290,7 @@ repeat:
 	bh->b_dev=dev;
 	bh->b_blocknr=block;
 	insert_into_queues(bh);
+	tracepoint(TR_GETBLK_MISS,dev,block);
 	return bh;
 }
 
@@ -295,10 +301,11 @@ void brelse(struct buffer_head * buf)
 		return;
 	wait_on_buffer(buf);
 	// 引用计数-1
-	if (!(buf->b_count--))
+	if (!buf->b_count)
 		panic("Trying to free free buffer");
-	// 唤醒等待空闲缓冲区的进程
-	wake_up(&buffer_wait);
+	// 唤醒一个等待空闲缓冲区的进程
+	if (!--buf->b_count)
+		wake_up_one(&buffer_wait);
 }
 
 /*
@@ -367,6 +374,51 @@ void bread_page(unsigned long address,int dev,int b[4])
 		}
 }
 
+/*
+ * bread_page_ahead() starts reading the buffers of a page without
+ * waiting for them, so that a later bread_page() of the same blocks
+ * finds them in the cache. As with breada, it's only a hint: if the
+ * request queue is full the read is simply dropped.
+ */
+void bread_page_ahead(int dev,int b[4])
+{
+	struct buffer_head * bh;
+	int i;
+
+	for (i=0 ; i<4 ; i++)
+		if (b[i] && (bh = getblk(dev,b[i]))) {
+			if (!bh->b_uptodate)
+				ll_rw_block(READA,bh);
+			bh->b_count--;
+		}
+}
+
+/*
+ * bread_page_cached() is bread_page() for pages that are already in the
+ * cache: it copies the buffers only if all of them are there and up to
+ * date, and returns 0 without touching the page otherwise. It never
+ * sleeps nor starts any I/O.
+ */
+int bread_page_cached(unsigned long address,int dev,int b[4])
+{
+	struct buffer_head * bh[4];
+	int i;
+
+	for (i=0 ; i<4 ; i++) {
+		bh[i] = NULL;
+		if (!b[i])
+			continue;
+		if (!(bh[i] = find_buffer(dev,b[i])))
+			return 0;
+		if (bh[i]->b_lock || !bh[i]->b_uptodate)
+			return 0;
+	}
+	for (i=0 ; i<4 ; i++,address += BLOCK_SIZE)
+		if (bh[i])
+			COPYBLK((unsigned long) bh[i]->b_data,address);
+	return 1;
+}
+
 /*
  * Ok, breada can be used as bread, but additionally to mark other
  * blocks for reading as well. End the argument list with a negative
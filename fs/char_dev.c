@@ -5,30 +5,38 @@
  */
 
 #include <errno.h>
+#include <poll.h>
 #include <sys/types.h>
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/tty.h>
 
 #include <asm/segment.h>
 #include <asm/io.h>
 
-extern int tty_read(unsigned minor,char * buf,int count);
-extern int tty_write(unsigned minor,char * buf,int count);
+extern int tty_poll(unsigned minor,int events,struct poll_table * pt);
+extern int pty_master_poll(unsigned minor,int events,struct poll_table * pt);
 
-typedef int (*crw_ptr)(int rw,unsigned minor,char * buf,int count,off_t * pos);
+typedef int (*crw_ptr)(int rw,unsigned minor,char * buf,int count,off_t * pos,
+	int flags);
 
-static int rw_ttyx(int rw,unsigned minor,char * buf,int count,off_t * pos)
+static int rw_ttyx(int rw,unsigned minor,char * buf,int count,off_t * pos,
+	int flags)
 {
-	return ((rw==READ)?tty_read(minor,buf,count):
+	if (minor & PTY_MASTER)
+		return ((rw==READ)?pty_master_read(minor,buf,count,flags):
+			pty_master_write(minor,buf,count,flags));
+	return ((rw==READ)?tty_read(minor,buf,count,flags):
 		tty_write(minor,buf,count));
 }
 
-static int rw_tty(int rw,unsigned minor,char * buf,int count, off_t * pos)
+static int rw_tty(int rw,unsigned minor,char * buf,int count, off_t * pos,
+	int flags)
 {
 	if (current->tty<0)
 		return -EPERM;
-	return rw_ttyx(rw,current->tty,buf,count,pos);
+	return rw_ttyx(rw,current->tty,buf,count,pos,flags);
 }
 
 static int rw_ram(int rw,char * buf, int count, off_t *pos)
@@ -62,7 +70,31 @@ static int rw_port(int rw,char * buf, int count, off_t * pos)
 	return i;
 }
 
-static int rw_memory(int rw, unsigned minor, char * buf, int count, off_t * pos)
+/* reading gets the kernel profile, writing clears it */
+static int rw_profile(int rw,char * buf, int count, off_t * pos)
+{
+	unsigned long size = prof_len * sizeof(long);
+	int i;
+
+	if (rw==WRITE) {
+		if (!suser())
+			return -EPERM;
+		for (i=0 ; i<prof_len ; i++)
+			prof_buffer[i] = 0;
+		return count;
+	}
+	if (*pos >= size)
+		return 0;
+	if (count > size - *pos)
+		count = size - *pos;
+	for (i=0 ; i<count ; i++)
+		put_fs_byte(((char *) prof_buffer)[*pos+i],buf+i);
+	*pos += count;
+	return count;
+}
+
+static int rw_memory(int rw, unsigned minor, char * buf, int count, off_t * pos,
+	int flags)
 {
 	switch(minor) {
 		case 0:
@@ -75,6 +107,8 @@ static int rw_memory(int rw, unsigned minor, char * buf, int count, off_t * pos)
 			return (rw==READ)?0:count;	/* rw_null */
 		case 4:
 			return rw_port(rw,buf,count,pos);
+		case 5:
+			return rw_profile(rw,buf,count,pos);
 		default:
 			return -EIO;
 	}
@@ -92,7 +126,7 @@ static crw_ptr crw_table[]={
 	NULL,		/* /dev/lp */
 	NULL};		/* unnamed pipes */
 
-int rw_char(int rw,int dev, char * buf, int count, off_t * pos)
+int rw_char(int rw,int dev, char * buf, int count, off_t * pos, int flags)
 {
 	crw_ptr call_addr;
 
@@ -100,5 +134,25 @@ int rw_char(int rw,int dev, char * buf, int count, off_t * pos)
 		return -ENODEV;
 	if (!(call_addr=crw_table[MAJOR(dev)]))
 		return -ENODEV;
-	return call_addr(rw,MINOR(dev),buf,count,pos);
+	return call_addr(rw,MINOR(dev),buf,count,pos,flags);
+}
+
+/*
+ * char_poll() is for select() and poll(). Only the ttys ever make
+ * anybody wait.
+ */
+int char_poll(int dev, int events, struct poll_table * pt)
+{
+	switch (MAJOR(dev)) {
+		case 4:
+			if (MINOR(dev) & PTY_MASTER)
+				return pty_master_poll(MINOR(dev),events,pt);
+			return tty_poll(MINOR(dev),events,pt);
+		case 5:
+			if (current->tty<0)
+				return POLLERR;
+			return tty_poll(current->tty,events,pt);
+		default:
+			return POLLIN | POLLOUT;
+	}
 }
@@ -4,6 +4,42 @@
  *  (C) 1991  Linus Torvalds
  */
 
+#include <string.h>
+
 #include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+
+/*
+ * Open files come from a slab cache: the table only takes as much memory
+ * as there are files open. NR_FILE still puts a limit on it.
+ */
+static struct kmem_cache * filp_cachep;
+static int nr_files = 0;
+
+struct file * get_empty_filp(void)
+{
+	struct file * f;
+
+	if (nr_files >= NR_FILE)
+		return NULL;
+	nr_files++;
+	if (!(f = (struct file *) kmem_cache_alloc(filp_cachep,GFP_KERNEL))) {
+		nr_files--;
+		return NULL;
+	}
+	memset(f,0,sizeof(*f));
+	f->f_count = 1;
+	return f;
+}
+
+void free_filp(struct file * filp)
+{
+	kmem_cache_free(filp_cachep,filp);
+	nr_files--;
+}
 
-struct file file_table[NR_FILE];
+void file_table_init(void)
+{
+	filp_cachep = kmem_cache_create("file",sizeof(struct file),NULL);
+}
@@ -10,9 +10,18 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/mm.h>
+#include <linux/slab.h>
 #include <asm/system.h>
 
-struct m_inode inode_table[NR_INODE]={{0,},};
+/*
+ * In-memory inodes come from a slab cache and are kept on a circular
+ * list. They are never given back: once the list has grown to NR_INODE,
+ * unused inodes are recycled just as the old fixed table was.
+ */
+static struct kmem_cache * inode_cachep;
+static struct m_inode * first_inode = NULL;
+static struct m_inode * last_inode = NULL;
+static int nr_inodes = 0;
 
 static void read_inode(struct m_inode * inode);
 static void write_inode(struct m_inode * inode);
@@ -29,7 +38,7 @@ static inline void lock_inode(struct m_inode * inode)
 {
 	cli();
 	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
+		sleep_on_exclusive(&inode->i_wait);
 	inode->i_lock=1;
 	sti();
 }
@@ -37,7 +46,35 @@ static inline void lock_inode(struct m_inode * inode)
 static inline void unlock_inode(struct m_inode * inode)
 {
 	inode->i_lock=0;
-	wake_up(&inode->i_wait);
+	wake_up_one(&inode->i_wait);
+}
+
+static void insert_inode(struct m_inode * inode)
+{
+	if (!first_inode) {
+		inode->i_next = inode->i_prev = inode;
+		first_inode = last_inode = inode;
+	} else {
+		inode->i_next = first_inode;
+		inode->i_prev = first_inode->i_prev;
+		first_inode->i_prev->i_next = inode;
+		first_inode->i_prev = inode;
+	}
+	nr_inodes++;
+}
+
+static void clear_inode(struct m_inode * inode)
+{
+	struct m_inode * next = inode->i_next, * prev = inode->i_prev;
+
+	memset(inode,0,sizeof(*inode));
+	inode->i_next = next;
+	inode->i_prev = prev;
+}
+
+void inode_init(void)
+{
+	inode_cachep = kmem_cache_create("inode",sizeof(struct m_inode),NULL);
 }
 
 void invalidate_inodes(int dev)
@@ -45,8 +82,8 @@ void invalidate_inodes(int dev)
 	int i;
 	struct m_inode * inode;
 
-	inode = 0+inode_table;
-	for(i=0 ; i<NR_INODE ; i++,inode++) {
+	inode = first_inode;
+	for(i=nr_inodes ; i-- ; inode=inode->i_next) {
 		wait_on_inode(inode);
 		if (inode->i_dev == dev) {
 			if (inode->i_count)
@@ -61,8 +98,8 @@ void sync_inodes(void)
 	int i;
 	struct m_inode * inode;
 
-	inode = 0+inode_table;
-	for(i=0 ; i<NR_INODE ; i++,inode++) {
+	inode = first_inode;
+	for(i=nr_inodes ; i-- ; inode=inode->i_next) {
 		wait_on_inode(inode);
 		if (inode->i_dirt && !inode->i_pipe)
 			write_inode(inode);
@@ -155,7 +192,7 @@ void iput(struct m_inode * inode)
 	if (!inode->i_count)
 		panic("iput: trying to free free inode");
 	if (inode->i_pipe) {
-		wake_up(&inode->i_wait);
+		wake_up_all(&inode->i_wait);
 		if (--inode->i_count)
 			return;
 		free_page(inode->i_size);
@@ -194,24 +231,29 @@ repeat:
 struct m_inode * get_empty_inode(void)
 {
 	struct m_inode * inode;
-	static struct m_inode * last_inode = inode_table;
 	int i;
 
 	do {
 		inode = NULL;
-		for (i = NR_INODE; i ; i--) {
-			if (++last_inode >= inode_table + NR_INODE)
-				last_inode = inode_table;
+		for (i = nr_inodes; i ; i--) {
+			last_inode = last_inode->i_next;
 			if (!last_inode->i_count) {
 				inode = last_inode;
 				if (!inode->i_dirt && !inode->i_lock)
 					break;
 			}
 		}
+/* rather grow than wait for a dirty inode to be written */
+		if (!i && nr_inodes < NR_INODE &&
+		    (inode = kmem_cache_alloc(inode_cachep,GFP_KERNEL))) {
+			memset(inode,0,sizeof(*inode));
+			insert_inode(inode);
+			inode->i_count = 1;
+			return inode;
+		}
 		if (!inode) {
-			for (i=0 ; i<NR_INODE ; i++)
-				printk("%04x: %6d\t",inode_table[i].i_dev,
-					inode_table[i].i_num);
+			for (i=nr_inodes,inode=first_inode ; i-- ; inode=inode->i_next)
+				printk("%04x: %6d\t",inode->i_dev,inode->i_num);
 			panic("No free inodes in mem");
 		}
 		wait_on_inode(inode);
@@ -220,11 +262,23 @@ struct m_inode * get_empty_inode(void)
 			wait_on_inode(inode);
 		}
 	} while (inode->i_count);
-	memset(inode,0,sizeof(*inode));
+	clear_inode(inode);
 	inode->i_count = 1;
 	return inode;
 }
 
+int fs_may_umount(int dev)
+{
+	struct m_inode * inode;
+	int i;
+
+	inode = first_inode;
+	for(i=nr_inodes ; i-- ; inode=inode->i_next)
+		if (inode->i_dev==dev && inode->i_count)
+			return 0;
+	return 1;
+}
+
 struct m_inode * get_pipe_inode(void)
 {
 	struct m_inode * inode;
@@ -244,19 +298,23 @@ struct m_inode * get_pipe_inode(void)
 struct m_inode * iget(int dev,int nr)
 {
 	struct m_inode * inode, * empty;
+	int n;
 
 	if (!dev)
 		panic("iget with dev==0");
 	empty = get_empty_inode();
-	inode = inode_table;
-	while (inode < NR_INODE+inode_table) {
+	inode = first_inode;
+	n = nr_inodes;
+	while (n) {
 		if (inode->i_dev != dev || inode->i_num != nr) {
-			inode++;
+			inode = inode->i_next;
+			n--;
 			continue;
 		}
 		wait_on_inode(inode);
 		if (inode->i_dev != dev || inode->i_num != nr) {
-			inode = inode_table;
+			inode = first_inode;
+			n = nr_inodes;
 			continue;
 		}
 		inode->i_count++;
@@ -275,7 +333,8 @@ struct m_inode * iget(int dev,int nr)
 			iput(inode);
 			dev = super_block[i].s_dev;
 			nr = ROOT_INO;
-			inode = inode_table;
+			inode = first_inode;
+			n = nr_inodes;
 			continue;
 		}
 		if (empty)
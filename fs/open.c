@@ -148,21 +148,20 @@ int sys_open(const char * filename,int flag,int mode)
 	if (fd>=NR_OPEN)
 		return -EINVAL;
 	current->close_on_exec &= ~(1<<fd);
-	f=0+file_table;
-	for (i=0 ; i<NR_FILE ; i++,f++)
-		if (!f->f_count) break;
-	if (i>=NR_FILE)
+	if (!(f=get_empty_filp()))
 		return -EINVAL;
-	(current->filp[fd]=f)->f_count++;
+	current->filp[fd]=f;
 	if ((i=open_namei(filename,flag,mode,&inode))<0) {
 		current->filp[fd]=NULL;
-		f->f_count=0;
+		free_filp(f);
 		return i;
 	}
 /* ttys are somewhat special (ttyxx major==4, tty major==5) */
 	if (S_ISCHR(inode->i_mode)) {
 		if (MAJOR(inode->i_zone[0])==4) {
-			if (current->leader && current->tty<0) {
+			pty_open(MINOR(inode->i_zone[0]));
+			if (current->leader && current->tty<0 &&
+			    !(MINOR(inode->i_zone[0]) & PTY_MASTER)) {
 				current->tty = MINOR(inode->i_zone[0]);
 				tty_table[current->tty].pgrp = current->pgrp;
 			}
@@ -170,7 +169,7 @@ int sys_open(const char * filename,int flag,int mode)
 			if (current->tty<0) {
 				iput(inode);
 				current->filp[fd]=NULL;
-				f->f_count=0;
+				free_filp(f);
 				return -EPERM;
 			}
 	}
@@ -204,6 +203,10 @@ int sys_close(unsigned int fd)
 		panic("Close: file count is 0");
 	if (--filp->f_count)
 		return (0);
+	if (S_ISCHR(filp->f_inode->i_mode) &&
+	    MAJOR(filp->f_inode->i_zone[0])==4)
+		pty_close(MINOR(filp->f_inode->i_zone[0]));
 	iput(filp->f_inode);
+	free_filp(filp);
 	return (0);
 }
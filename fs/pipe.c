@@ -5,6 +5,7 @@
  */
 
 #include <signal.h>
+#include <poll.h>
 
 #include <linux/sched.h>
 #include <linux/mm.h>	/* for get_free_page */
@@ -16,7 +17,7 @@ int read_pipe(struct m_inode * inode, char * buf, int count)
 
 	while (count>0) {
 		while (!(size=PIPE_SIZE(*inode))) {
-			wake_up(&inode->i_wait);
+			wake_up_all(&inode->i_wait);
 			if (inode->i_count != 2) /* are there any writers? */
 				return read;
 			sleep_on(&inode->i_wait);
@@ -34,7 +35,7 @@ int read_pipe(struct m_inode * inode, char * buf, int count)
 		while (chars-->0)
 			put_fs_byte(((char *)inode->i_size)[size++],buf++);
 	}
-	wake_up(&inode->i_wait);
+	wake_up_all(&inode->i_wait);
 	return read;
 }
 	
@@ -44,7 +45,7 @@ int write_pipe(struct m_inode * inode, char * buf, int count)
 
 	while (count>0) {
 		while (!(size=(PAGE_SIZE-1)-PIPE_SIZE(*inode))) {
-			wake_up(&inode->i_wait);
+			wake_up_all(&inode->i_wait);
 			if (inode->i_count != 2) { /* no readers */
 				current->signal |= (1<<(SIGPIPE-1));
 				return written?written:-1;
@@ -64,10 +65,36 @@ int write_pipe(struct m_inode * inode, char * buf, int count)
 		while (chars-->0)
 			((char *)inode->i_size)[size++]=get_fs_byte(buf++);
 	}
-	wake_up(&inode->i_wait);
+	wake_up_all(&inode->i_wait);
 	return written;
 }
 
+/*
+ * pipe_poll() is for select() and poll(). Once the other end is closed,
+ * the read end is readable, as read_pipe() doesn't wait any more, and
+ * the write end is an error.
+ */
+int pipe_poll(struct m_inode * inode, int mode, int events,
+	struct poll_table * pt)
+{
+	int mask = 0;
+
+	poll_wait(&inode->i_wait,pt);
+	if (mode & 1) {
+		if (!PIPE_EMPTY(*inode))
+			mask |= POLLIN;
+		if (inode->i_count != 2)
+			mask |= POLLHUP;
+	}
+	if (mode & 2) {
+		if (inode->i_count != 2)
+			mask |= POLLERR;
+		else if (!PIPE_FULL(*inode))
+			mask |= POLLOUT;
+	}
+	return mask;
+}
+
 int sys_pipe(unsigned long * fildes)
 {
 	struct m_inode * inode;
@@ -75,14 +102,12 @@ int sys_pipe(unsigned long * fildes)
 	int fd[2];
 	int i,j;
 
-	j=0;
-	for(i=0;j<2 && i<NR_FILE;i++)
-		if (!file_table[i].f_count)
-			(f[j++]=i+file_table)->f_count++;
-	if (j==1)
-		f[0]->f_count=0;
-	if (j<2)
+	if (!(f[0]=get_empty_filp()))
+		return -1;
+	if (!(f[1]=get_empty_filp())) {
+		free_filp(f[0]);
 		return -1;
+	}
 	j=0;
 	for(i=0;j<2 && i<NR_OPEN;i++)
 		if (!current->filp[i]) {
@@ -92,13 +117,15 @@ int sys_pipe(unsigned long * fildes)
 	if (j==1)
 		current->filp[fd[0]]=NULL;
 	if (j<2) {
-		f[0]->f_count=f[1]->f_count=0;
+		free_filp(f[0]);
+		free_filp(f[1]);
 		return -1;
 	}
 	if (!(inode=get_pipe_inode())) {
 		current->filp[fd[0]] =
 			current->filp[fd[1]] = NULL;
-		f[0]->f_count = f[1]->f_count = 0;
+		free_filp(f[0]);
+		free_filp(f[1]);
 		return -1;
 	}
 	f[0]->f_inode = f[1]->f_inode = inode;
@@ -0,0 +1,209 @@
+/*
+ *  linux/fs/select.c
+ */
+
+/*
+ * select() and poll() wait on many descriptors at once. Each kind of
+ * file has a poll function that says what is there now, and puts the
+ * caller on the wait queues that are woken when that changes. Once it
+ * is on all of them, the caller sleeps, and looks again at everything
+ * when any one of them wakes it up. Files and block devices never have
+ * to be waited for.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define USEC_PER_TICK (1000000/HZ)
+#define MSEC_PER_TICK (1000/HZ)
+
+extern int pipe_poll(struct m_inode * inode, int mode, int events,
+	struct poll_table * pt);
+extern int char_poll(int dev, int events, struct poll_table * pt);
+
+static int poll_fd(int fd, int events, struct poll_table * pt)
+{
+	struct file * file;
+	struct m_inode * inode;
+	int mask;
+
+	if (fd < 0)
+		return 0;
+	if (fd >= NR_OPEN || !(file = current->filp[fd]) ||
+	    !(inode = file->f_inode))
+		return POLLNVAL;
+	if (inode->i_pipe)
+		mask = pipe_poll(inode,file->f_mode,events,pt);
+	else if (S_ISCHR(inode->i_mode))
+		mask = char_poll(inode->i_zone[0],events,pt);
+	else
+		mask = POLLIN | POLLOUT;
+	return mask & (events | POLLERR | POLLHUP);
+}
+
+/*
+ * do_poll() fills in 'revents' for the 'nr' entries, and returns how
+ * many have something. If none has, it waits for at most '*timeout'
+ * ticks (less than 0 is forever) and leaves what is left of it there.
+ * The caller is only put on the queues the first time round.
+ */
+static int do_poll(struct pollfd * fds, int nr, long * timeout)
+{
+	struct poll_table table, * pt = &table;
+	long expires = jiffies + *timeout, ticks;
+	int i, count;
+
+	if (!(table.entry = (struct poll_table_entry *) get_free_page()))
+		return -ENOMEM;
+	table.nr = 0;
+	for (;;) {
+		current->state = TASK_INTERRUPTIBLE;
+		count = 0;
+		for (i = 0 ; i < nr ; i++)
+			if ((fds[i].revents = poll_fd(fds[i].fd,fds[i].events,pt)))
+				count++;
+		pt = NULL;
+		if (count || current->signal)
+			break;
+		if (*timeout < 0) {
+			schedule();
+			continue;
+		}
+		if ((ticks = expires - jiffies) <= 0)
+			break;
+		cli();
+		add_timer_data(ticks,process_timeout,(unsigned long) current);
+		schedule();
+		del_timer(process_timeout,(unsigned long) current);
+		sti();
+	}
+	current->state = TASK_RUNNING;
+	poll_freewait(&table);
+	free_page((unsigned long) table.entry);
+	if (*timeout > 0 && (*timeout = expires - jiffies) < 0)
+		*timeout = 0;
+	if (!count && current->signal)
+		return -EINTR;
+	return count;
+}
+
+/*
+ * sys_select() takes its five arguments from 'buffer'. Nothing is ever
+ * exceptional, but the descriptors in that set have to be open too.
+ */
+int sys_select(unsigned long * buffer)
+{
+	struct pollfd fds[NR_OPEN];
+	fd_set * inp, * outp, * exp;
+	struct timeval * tvp;
+	unsigned long in, out, ex, bit, rin = 0, rout = 0;
+	long sec, usec, ticks = -1;
+	int n, i, nr = 0, count;
+
+	n = get_fs_long(buffer);
+	inp = (fd_set *) get_fs_long(buffer+1);
+	outp = (fd_set *) get_fs_long(buffer+2);
+	exp = (fd_set *) get_fs_long(buffer+3);
+	tvp = (struct timeval *) get_fs_long(buffer+4);
+	if (n < 0)
+		return -EINVAL;
+	if (n > NR_OPEN)
+		n = NR_OPEN;
+	in = inp ? get_fs_long(inp->fds_bits) & ((1UL << n) - 1) : 0;
+	out = outp ? get_fs_long(outp->fds_bits) & ((1UL << n) - 1) : 0;
+	ex = exp ? get_fs_long(exp->fds_bits) & ((1UL << n) - 1) : 0;
+	for (i = 0 ; i < n ; i++) {
+		bit = 1UL << i;
+		if (!((in | out | ex) & bit))
+			continue;
+		if (!current->filp[i] || !current->filp[i]->f_inode)
+			return -EBADF;
+		if (!((in | out) & bit))
+			continue;
+		fds[nr].fd = i;
+		fds[nr].events = ((in & bit) ? POLLIN : 0) |
+			((out & bit) ? POLLOUT : 0);
+		nr++;
+	}
+	if (tvp) {
+		sec = get_fs_long((unsigned long *) &tvp->tv_sec);
+		usec = get_fs_long((unsigned long *) &tvp->tv_usec);
+		if (sec < 0 || usec < 0)
+			return -EINVAL;
+		if (sec >= 0x7fffffff/HZ - 1)
+			sec = 0x7fffffff/HZ - 2;
+		ticks = sec*HZ + (usec + USEC_PER_TICK - 1) / USEC_PER_TICK;
+		if (ticks)
+			ticks++;
+	}
+	if ((count = do_poll(fds,nr,&ticks)) < 0)
+		return count;
+	count = 0;
+	for (i = 0 ; i < nr ; i++) {
+		bit = 1UL << fds[i].fd;
+		if ((in & bit) && (fds[i].revents & (POLLIN|POLLHUP|POLLERR))) {
+			rin |= bit;
+			count++;
+		}
+		if ((out & bit) && (fds[i].revents & (POLLOUT|POLLERR))) {
+			rout |= bit;
+			count++;
+		}
+	}
+	if (inp) {
+		verify_area(inp,sizeof *inp);
+		put_fs_long(rin,inp->fds_bits);
+	}
+	if (outp) {
+		verify_area(outp,sizeof *outp);
+		put_fs_long(rout,outp->fds_bits);
+	}
+	if (exp) {
+		verify_area(exp,sizeof *exp);
+		put_fs_long(0,exp->fds_bits);
+	}
+	if (tvp && ticks >= 0) {
+		verify_area(tvp,sizeof *tvp);
+		put_fs_long(ticks / HZ,(unsigned long *) &tvp->tv_sec);
+		put_fs_long((ticks % HZ) * USEC_PER_TICK,
+			(unsigned long *) &tvp->tv_usec);
+	}
+	return count;
+}
+
+/*
+ * sys_poll() takes at most NR_OPEN entries, as there is no point in
+ * more. The timeout is in milliseconds, less than 0 is forever.
+ */
+int sys_poll(struct pollfd * ufds, unsigned int nfds, int timeout)
+{
+	struct pollfd fds[NR_OPEN];
+	long ticks = -1;
+	int i, count;
+
+	if (nfds > NR_OPEN)
+		return -EINVAL;
+	for (i = 0 ; i < nfds ; i++) {
+		fds[i].fd = get_fs_long((unsigned long *) &ufds[i].fd);
+		fds[i].events = get_fs_word((unsigned short *) &ufds[i].events);
+	}
+	if (timeout >= 0) {
+		ticks = timeout / MSEC_PER_TICK + (timeout % MSEC_PER_TICK != 0);
+		if (ticks)
+			ticks++;
+	}
+	if ((count = do_poll(fds,nfds,&ticks)) < 0)
+		return count;
+	verify_area(ufds,nfds * sizeof *ufds);
+	for (i = 0 ; i < nfds ; i++)
+		put_fs_word(fds[i].revents,(short *) &ufds[i].revents);
+	return count;
+}
@@ -32,7 +32,7 @@ static void lock_super(struct super_block * sb)
 {
 	cli();
 	while (sb->s_lock)
-		sleep_on(&(sb->s_wait));
+		sleep_on_exclusive(&(sb->s_wait));
 	sb->s_lock = 1;
 	sti();
 }
@@ -41,7 +41,7 @@ static void free_super(struct super_block * sb)
 {
 	cli();
 	sb->s_lock = 0;
-	wake_up(&(sb->s_wait));
+	wake_up_one(&(sb->s_wait));
 	sti();
 }
 
@@ -184,9 +184,8 @@ int sys_umount(char * dev_name)
 		return -ENOENT;
 	if (!sb->s_imount->i_mount)
 		printk("Mounted inode has i_mount=0\n");
-	for (inode=inode_table+0 ; inode<inode_table+NR_INODE ; inode++)
-		if (inode->i_dev==dev && inode->i_count)
-				return -EBUSY;
+	if (!fs_may_umount(dev))
+		return -EBUSY;
 	sb->s_imount->i_mount=0;
 	iput(sb->s_imount);
 	sb->s_imount = NULL;
@@ -247,8 +246,6 @@ void mount_root(void)
 
 	if (32 != sizeof (struct d_inode))
 		panic("bad i-node size");
-	for(i=0;i<NR_FILE;i++)
-		file_table[i].f_count=0;
 	if (MAJOR(ROOT_DEV) == 2) {
 		printk("Insert root floppy and press ENTER");
 		wait_for_keypress();
@@ -0,0 +1,46 @@
+#ifndef _ASM_SPINLOCK_H
+#define _ASM_SPINLOCK_H
+
+/*
+ * Spinlocks keep the other cpus out of a critical section, as cli()
+ * only keeps out the interrupts of this one. They don't nest, and
+ * nothing may sleep holding one. The _irqsave versions are for data
+ * interrupts touch too.
+ */
+typedef struct {
+	volatile unsigned long lock;
+} spinlock_t;
+
+#define SPIN_LOCK_UNLOCKED { 0 }
+
+#define cpu_relax() __asm__ __volatile__("rep ; nop":::"memory")
+
+static inline int spin_trylock(spinlock_t * lock)
+{
+	unsigned long old;
+
+	__asm__ __volatile__("lock ; btsl $0,%1\n\t"
+		"sbbl %0,%0"
+		:"=r" (old),"+m" (lock->lock)::"memory");
+	return !old;
+}
+
+static inline void spin_lock(spinlock_t * lock)
+{
+	while (!spin_trylock(lock))
+		while (lock->lock)
+			cpu_relax();
+}
+
+static inline void spin_unlock(spinlock_t * lock)
+{
+	__asm__ __volatile__("movl $0,%0":"=m" (lock->lock)::"memory");
+}
+
+#define spin_lock_irqsave(lock,flags) \
+do { save_flags(flags); cli(); spin_lock(lock); } while (0)
+
+#define spin_unlock_irqrestore(lock,flags) \
+do { spin_unlock(lock); restore_flags(flags); } while (0)
+
+#endif
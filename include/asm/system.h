@@ -1,8 +1,28 @@
+/*
+ * main() runs on the kernel stack of task 0, as that is what 'current'
+ * goes by. Task 0 goes on in user mode on user_stack: what is on the
+ * stack so far is moved over there first, %ebp too.
+ */
 #define move_to_user_mode() \
-__asm__ ("movl %%esp,%%eax\n\t" \
+__asm__ ("cli\n\t" \
+	"movl %%esp,%%esi\n\t" \
+	"movl %%esp,%%ecx\n\t" \
+	"orl $4095,%%ecx\n\t" \
+	"subl %%esp,%%ecx\n\t" \
+	"incl %%ecx\n\t" \
+	"movl $user_stack+4096,%%edi\n\t" \
+	"subl %%ecx,%%edi\n\t" \
+	"movl %%edi,%%eax\n\t" \
+	"subl %%esi,%%eax\n\t" \
+	"addl %%eax,%%ebp\n\t" \
+	"movl %%edi,%%esp\n\t" \
+	"shrl $2,%%ecx\n\t" \
+	"cld ; rep ; movsl\n\t" \
+	"movl %%esp,%%eax\n\t" \
 	"pushl $0x17\n\t" \
 	"pushl %%eax\n\t" \
 	"pushfl\n\t" \
+	"orl $0x200,(%%esp)\n\t" \
 	"pushl $0x0f\n\t" \
 	"pushl $1f\n\t" \
 	"iret\n" \
@@ -11,12 +31,25 @@ __asm__ ("movl %%esp,%%eax\n\t" \
 	"movw %%ax,%%es\n\t" \
 	"movw %%ax,%%fs\n\t" \
 	"movw %%ax,%%gs" \
-	:::"ax")
+	:::"ax","cx","si","di","memory")
 
 #define sti() __asm__ ("sti"::)
 #define cli() __asm__ ("cli"::)
 #define nop() __asm__ ("nop"::)
 
+#define rdtsc() ({ \
+unsigned long long __tsc; \
+__asm__ __volatile__("rdtsc":"=A" (__tsc)); \
+__tsc; })
+
+#define wrmsr(msr,low,high) \
+__asm__ __volatile__("wrmsr"::"c" (msr),"a" (low),"d" (high))
+
+#define save_flags(x) \
+__asm__ __volatile__("pushfl ; popl %0":"=r" (x)::"memory")
+#define restore_flags(x) \
+__asm__ __volatile__("pushl %0 ; popfl"::"r" (x):"memory")
+
 #define iret() __asm__ ("iret"::)
 
 #define _set_gate(gate_addr,type,dpl,addr) \
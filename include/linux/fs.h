@@ -7,6 +7,7 @@
 #define _FS_H
 
 #include <sys/types.h>
+#include <asm/spinlock.h>
 
 /* devices are as follows: (same as minix, so we can use the minix
  * file system. These are major numbers.)
@@ -41,8 +42,9 @@ void buffer_init(long buffer_end);
 #define SUPER_MAGIC 0x137F
 
 #define NR_OPEN 20
-#define NR_INODE 32
-#define NR_FILE 64
+/* in-memory inodes and open files grow on demand, up to these */
+#define NR_INODE ((int)(HIGH_MEMORY>>15))
+#define NR_FILE ((int)(HIGH_MEMORY>>14))
 #define NR_SUPER 8
 #define NR_HASH 307
 #define NR_BUFFERS nr_buffers
@@ -74,7 +76,7 @@ struct buffer_head {
 	unsigned char b_dirt; // 是否占用 0 没有 1 被使用 /* 0-clean,1-dirty */
 	unsigned char b_count;		/* users using this block */
 	unsigned char b_lock; // 锁定是否		/* 0 - ok, 1 -locked */
-	struct task_struct * b_wait; // 等待该高速缓冲区释放的进程结构体指针 
+	struct wait_queue * b_wait; // 等待该高速缓冲区释放的进程结构体指针 
 	// 散列数组
 	struct buffer_head * b_prev;
 	struct buffer_head * b_next;
@@ -120,7 +122,7 @@ struct m_inode {
 	// i_zone[9] 二次间接块号，占用逻辑块太多（>512+7 && < 512*7) 启用二级逻辑块号
 	unsigned short i_zone[9];  
 /* these are in memory also */
-	struct task_struct * i_wait;
+	struct wait_queue * i_wait;
 	unsigned long i_atime;
 	unsigned long i_ctime;
 	unsigned short i_dev;
@@ -132,6 +134,7 @@ struct m_inode {
 	unsigned char i_mount;
 	unsigned char i_seek;
 	unsigned char i_update;
+	struct m_inode * i_next, * i_prev;
 };
 
 struct file {
@@ -158,7 +161,7 @@ struct super_block {
 	struct m_inode * s_isup;
 	struct m_inode * s_imount;
 	unsigned long s_time;
-	struct task_struct * s_wait;
+	struct wait_queue * s_wait;
 	unsigned char s_lock;
 	unsigned char s_rd_only;
 	unsigned char s_dirt;
@@ -180,10 +183,9 @@ struct dir_entry {
 	char name[NAME_LEN];
 };
 
-extern struct m_inode inode_table[NR_INODE];
-extern struct file file_table[NR_FILE];
 extern struct super_block super_block[NR_SUPER];
 extern struct buffer_head * start_buffer;
+extern spinlock_t buffer_lock;
 extern int nr_buffers;
 
 extern void check_disk_change(int dev);
@@ -203,12 +205,19 @@ extern void iput(struct m_inode * inode);
 extern struct m_inode * iget(int dev,int nr);
 extern struct m_inode * get_empty_inode(void);
 extern struct m_inode * get_pipe_inode(void);
+extern int fs_may_umount(int dev);
+extern void inode_init(void);
+extern struct file * get_empty_filp(void);
+extern void free_filp(struct file * filp);
+extern void file_table_init(void);
 extern struct buffer_head * get_hash_table(int dev, int block);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
 extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
 extern void bread_page(unsigned long addr,int dev,int b[4]);
+extern void bread_page_ahead(int dev,int b[4]);
+extern int bread_page_cached(unsigned long addr,int dev,int b[4]);
 extern struct buffer_head * breada(int dev,int block,...);
 extern int new_block(int dev);
 extern void free_block(int dev, int block);
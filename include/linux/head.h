@@ -7,6 +7,17 @@ typedef struct desc_struct {
 
 extern unsigned long pg_dir[1024];
 extern desc_table idt,gdt;
+extern unsigned long cpu_features;	/* cpuid 1 edx, 0 without cpuid */
+
+#define CPU_PSE		0x00000008	/* 4Mb pages */
+#define CPU_TSC		0x00000010	/* time stamp counter */
+#define CPU_APIC	0x00000200	/* local APIC */
+#define CPU_SEP		0x00000800	/* sysenter */
+#define CPU_PGE		0x00002000	/* global pages */
+
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
 
 #define GDT_NUL 0
 #define GDT_CODE 1
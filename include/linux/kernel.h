@@ -5,9 +5,12 @@ void verify_area(void * addr,int count);
 void panic(const char * str);
 int printf(const char * fmt, ...);
 int printk(const char * fmt, ...);
+void console_drain(void);
+int console_print(const char * b, int count);
 int tty_write(unsigned ch,char * buf,int count);
 void * malloc(unsigned int size);
 void free_s(void * obj, int size);
+void udelay(unsigned long usecs);
 
 #define free(x) free_s((x), 0)
 
@@ -3,8 +3,60 @@
 
 #define PAGE_SIZE 4096
 
-extern unsigned long get_free_page(void);
+/*
+ * GFP_KERNEL allocations may sleep while something is swapped out,
+ * GFP_ATOMIC ones (interrupts, and the swap code itself) never do.
+ */
+#define GFP_KERNEL	0
+#define GFP_ATOMIC	1
+
+extern unsigned long __get_free_page(int priority);
+#define get_free_page() __get_free_page(GFP_KERNEL)
 extern unsigned long put_page(unsigned long page,unsigned long address);
+extern unsigned long put_dirty_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
+extern unsigned long * get_pte(unsigned long address);
+
+extern int swap_out(void);
+extern void swap_in(unsigned long * table_ptr);
+extern void swap_free(int nr);
+extern void read_swap_page(int nr, char * buffer);
+
+#define __invalidate() \
+__asm__("movl %%cr3,%%eax\n\tmovl %%eax,%%cr3":::"ax")
+
+/* the other cpus may have the same page tables loaded, see kernel/smp.c */
+extern void flush_tlb(void);
+#define invalidate() flush_tlb()
+
+extern unsigned long ioremap(unsigned long phys);
+
+/* these are not to be changed without changing head.s etc */
+#define LOW_MEM 0x100000
+extern long HIGH_MEMORY;
+#define PAGING_PAGES MAP_NR(HIGH_MEMORY)
+#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
+#define USED 100
+
+extern unsigned char * mem_map;
+
+/*
+ * Every process has a page directory of its own. The first 1Gb of linear
+ * addresses identity-maps physical memory for the kernel and is the same
+ * in all of them, user space lives at TASK_BASE. The top 1Gb only has
+ * what ioremap() put there, and is shared too.
+ */
+#define TASK_BASE 0x40000000
+#define TASK_SIZE 0x80000000
+#define FIRST_USER_PGD (TASK_BASE>>22)
+#define USER_PGDS (TASK_SIZE>>22)
+
+#define PAGE_GLOBAL	0x100
+#define PAGE_PSE	0x80
+#define PAGE_DIRTY	0x40
+#define PAGE_ACCESSED	0x20
+#define PAGE_USER	0x04
+#define PAGE_RW		0x02
+#define PAGE_PRESENT	0x01
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef _RBTREE_H
+#define _RBTREE_H
+
+/*
+ * Red-black trees, for keeping things sorted with O(log n) updates. The
+ * node is embedded in whatever is being sorted, and the user does the
+ * search and links the new node in (rb_link_node()), then calls
+ * rb_insert_color() to rebalance.
+ */
+struct rb_node {
+	struct rb_node * rb_parent;
+	struct rb_node * rb_left;
+	struct rb_node * rb_right;
+	int rb_color;
+};
+
+#define RB_RED		0
+#define RB_BLACK	1
+
+struct rb_root {
+	struct rb_node * rb_node;
+};
+
+#define rb_entry(ptr,type,member) \
+	((type *) ((char *) (ptr) - (unsigned long) &((type *) 0)->member))
+
+static inline void rb_link_node(struct rb_node * node, struct rb_node * parent,
+	struct rb_node ** link)
+{
+	node->rb_parent = parent;
+	node->rb_color = RB_RED;
+	node->rb_left = node->rb_right = (struct rb_node *) 0;
+	*link = node;
+}
+
+extern void rb_insert_color(struct rb_node * node, struct rb_root * root);
+extern void rb_erase(struct rb_node * node, struct rb_root * root);
+extern struct rb_node * rb_first(struct rb_root * root);
+extern struct rb_node * rb_next(struct rb_node * node);
+
+#endif
@@ -10,6 +10,8 @@
 #include <linux/head.h>
 #include <linux/fs.h>
 #include <linux/mm.h>
+#include <linux/rbtree.h>
+#include <linux/smp.h>
 #include <signal.h>
 
 #if (NR_OPEN > 32)
@@ -32,11 +34,10 @@
 #define NULL ((void *) 0)
 #endif
 
-extern int copy_page_tables(unsigned long from, unsigned long to, long size);
-extern int free_page_tables(unsigned long from, unsigned long size);
-
 extern void sched_init(void);
 extern void schedule(void);
+extern void cpu_idle(void);
+extern void tss_init(int cpu);
 extern void trap_init(void);
 #ifndef PANIC
 void panic(const char * str);
@@ -94,6 +95,7 @@ struct task_struct {
 	long signal;
 	struct sigaction sigaction[32];
 	long blocked;	/* bitmap of masked signals */
+	long need_resched;	/* see ret_from_sys_call */
 /* various fields */
 	int exit_code;
 	unsigned long start_code,end_code,end_data,brk,start_stack;
@@ -102,6 +104,16 @@ struct task_struct {
 	unsigned short gid,egid,sgid;
 	long alarm;
 	long utime,stime,cutime,cstime,start_time;
+/* user mode profile, see sys_prof() */
+	unsigned long prof_buf,prof_size,prof_off,prof_scale;
+/* fair scheduling class, see sched_fair.c */
+	unsigned long vruntime;
+	struct rb_node run_node;
+	int on_rq;
+/* real-time policy, see <sched.h> */
+	long policy,rt_priority;
+/* smp: the cpu it is or was last on, is it running, kernel lock depth */
+	int processor,has_cpu,lock_depth;
 	unsigned short used_math;
 /* file system info */
 	int tty;		/* -1 if no tty, so it must be signed */
@@ -113,7 +125,7 @@ struct task_struct {
 	struct file * filp[NR_OPEN];
 /* ldt for this task 0 - zero 1 - cs 2 - ds&ss */
 	struct desc_struct ldt[3];
-/* tss for this task */
+/* saved state for this task, see switch_to() */
 	struct tss_struct tss;
 };
 
@@ -124,10 +136,15 @@ struct task_struct {
 #define INIT_TASK \
 /* state etc */	{ 0,15,15, \
 /* signals */	0,{{},},0, \
+/* resched */	0, \
 /* ec,brk... */	0,0,0,0,0,0, \
 /* pid etc.. */	0,-1,0,0,0, \
 /* uid etc */	0,0,0,0,0,0, \
 /* alarm */	0,0,0,0,0,0, \
+/* prof */	0,0,0,0, \
+/* fair */	0,{NULL,},0, \
+/* policy */	0,0, \
+/* smp */	0,1,0, \
 /* math */	0, \
 /* fs info */	-1,0022,NULL,NULL,NULL,0, \
 /* filp */	{NULL,}, \
@@ -145,21 +162,92 @@ struct task_struct {
 }
 
 extern struct task_struct *task[NR_TASKS];
-extern struct task_struct *last_task_used_math;
-extern struct task_struct *current;
+extern struct task_struct *idle_task[NR_CPUS];
+extern struct task_struct *cpu_last_math[NR_CPUS];
+#define last_task_used_math cpu_last_math[smp_processor_id()]
 extern long volatile jiffies;
 extern long startup_time;
 
+/*
+ * The kernel profile has a counter for every 1<<PROFILE_SHIFT bytes of
+ * kernel code, for the ticks that found the kernel there. System.map says
+ * what is where. It is read from /dev/profile, major 1 minor 5.
+ */
+#define PROFILE_SHIFT 4
+extern unsigned long * prof_buffer;
+extern unsigned long prof_len;
+
 #define CURRENT_TIME (startup_time+jiffies/HZ)
 
+extern int copy_page_tables(struct task_struct * tsk);
+extern int free_page_tables(struct task_struct * tsk);
+
+/*
+ * The task struct is at the bottom of its kernel stack page, so the
+ * stack pointer tells which task this cpu is running.
+ */
+#define current ({ \
+struct task_struct * __current; \
+__asm__("andl %%esp,%0":"=r" (__current):"0" (~(PAGE_SIZE-1))); \
+__current; })
+
+/* task 0 and the idle tasks of the other cpus, see schedule() */
+#define is_idle_task(p) (!(p)->pid)
+
+extern void update_process_times(long cpl, unsigned long eip);
+extern int sched_fair;
+extern int fair_pick_next(void);
+extern void fair_tick(void);
+extern int fair_wakeup_preempt(struct task_struct * p);
+
 extern void add_timer(long jiffies, void (*fn)(void));
-extern void sleep_on(struct task_struct ** p);
-extern void interruptible_sleep_on(struct task_struct ** p);
-extern void wake_up(struct task_struct ** p);
+extern void add_timer_data(long jiffies, void (*fn)(unsigned long),
+	unsigned long data);
+extern int del_timer(void (*fn)(unsigned long), unsigned long data);
+extern void process_timeout(unsigned long data);
+
+/*
+ * A wait queue is the list of tasks sleeping on something. Exclusive
+ * sleepers each wait for a resource only one of them can have: they are
+ * woken one at a time by wake_up_one(), all others by any wake-up.
+ */
+struct wait_queue {
+	struct task_struct * task;
+	struct wait_queue * next;
+	int exclusive;
+};
+
+extern void sleep_on(struct wait_queue ** p);
+extern void sleep_on_exclusive(struct wait_queue ** p);
+extern void interruptible_sleep_on(struct wait_queue ** p);
+extern void sleep_on_unlock(struct wait_queue ** p, spinlock_t * lock);
+extern void sleep_on_exclusive_unlock(struct wait_queue ** p,
+	spinlock_t * lock);
+extern void wake_up_one(struct wait_queue ** p);
+extern void wake_up_all(struct wait_queue ** p);
 
 /*
- * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
- * 4-TSS0, 5-LDT0, 6-TSS1 etc ...
+ * select() and poll() sleep on many wait queues at once, with an entry
+ * for each in a poll table, see fs/select.c. The entries take a page.
+ */
+struct poll_table_entry {
+	struct wait_queue wait;
+	struct wait_queue ** wait_address;
+};
+
+struct poll_table {
+	int nr;
+	struct poll_table_entry * entry;
+};
+
+#define POLL_TABLE_ENTRIES (PAGE_SIZE/sizeof(struct poll_table_entry))
+
+extern void poll_wait(struct wait_queue ** p, struct poll_table * pt);
+extern void poll_freewait(struct poll_table * pt);
+
+/*
+ * Entry into gdt where to find the TSS. 0-nul, 1-cs, 2-ds, 3-syscall
+ * 4-TSS0, 5-LDT0, 6-TSS1, 7-LDT1 etc ... TSSn is that of cpu n
  */
 #define FIRST_TSS_ENTRY 4
 #define FIRST_LDT_ENTRY (FIRST_TSS_ENTRY+1)
@@ -167,33 +255,76 @@ extern void wake_up(struct task_struct ** p);
 #define _LDT(n) ((((unsigned long) n)<<4)+(FIRST_LDT_ENTRY<<3))
 #define ltr(n) __asm__("ltr %%ax"::"a" (_TSS(n)))
 #define lldt(n) __asm__("lldt %%ax"::"a" (_LDT(n)))
-#define str(n) \
-__asm__("str %%ax\n\t" \
-	"subl %2,%%eax\n\t" \
-	"shrl $4,%%eax" \
-	:"=a" (n) \
-	:"a" (0),"i" (FIRST_TSS_ENTRY<<3))
+
 /*
- *	switch_to(n) should switch tasks to task nr n, first
- * checking that n isn't the current task, in which case it does nothing.
- * This also clears the TS-flag if the task we switched to has used
- * tha math co-processor latest.
+ * There is one TSS per cpu, cpu_tss[cpu] in gdt slot _TSS(cpu), as
+ * tasks are switched in software, and the cpu only needs it for esp0 on
+ * the way in from user mode. The tss in the task-struct just holds the
+ * state of a task that isn't running.
  */
-// 进程切换
-#define switch_to(n) {\
-struct {long a,b;} __tmp; \
-__asm__("cmpl %%ecx,current\n\t" \ // 要切换的进程是否为当前进程
-	"je 1f\n\t" \ // 如果是当前的进程 不进行任何操作
-	"movw %%dx,%1\n\t" \  
-	"xchgl %%ecx,current\n\t" \ // 将需要切换的进程的指针赋值给当前进程的指针 current
-	"ljmp *%0\n\t" \
-	"cmpl %%ecx,last_task_used_math\n\t" \
-	"jne 1f\n\t" \
-	"clts\n" \
-	"1:" \
-	::"m" (*&__tmp.a),"m" (*&__tmp.b), \
-	"d" (_TSS(n)),"c" ((long) task[n])); \
-}
+extern struct tss_struct cpu_tss[NR_CPUS];
+
+#define TSS_ESP ((long) &((struct task_struct *) 0)->tss.esp)
+#define TSS_EIP ((long) &((struct task_struct *) 0)->tss.eip)
+
+/*
+ *	switch_to(next) switches this cpu to task 'next', first checking
+ * that it isn't the current task, in which case it does nothing.
+ *
+ * Only the kernel stack, eflags, %ebp, %fs and %gs are switched by hand:
+ * the other registers are clobbered, so gcc saves what it needs, and the
+ * new stack makes 'next' current. The page directory is reloaded only if
+ * it changes. An idle task just borrows whatever is loaded, as all it
+ * touches is the kernel part - but only on one cpu: with more, the owner
+ * could exit on another one and free it. The math state is saved at
+ * once then too, as the task may go on on another cpu. The cpu no longer
+ * sets TS for us, so do that here unless the new task has used the math
+ * co-processor latest on this cpu.
+ */
+#define switch_to(next) do { \
+struct task_struct * __next = (next); \
+int __cpu = smp_processor_id(); \
+unsigned long __tmp; \
+long __d0, __d1; \
+if (__next != current) { \
+	if (smp_num_cpus > 1 && last_task_used_math == current) { \
+		__asm__("clts ; fnsave %0"::"m" (current->tss.i387)); \
+		last_task_used_math = NULL; \
+	} \
+	current->has_cpu = 0; \
+	__next->has_cpu = 1; \
+	__next->processor = __cpu; \
+	cpu_curr[__cpu] = __next; \
+	cpu_tss[__cpu].esp0 = PAGE_SIZE + (long) __next; \
+	__asm__("movl %%cr3,%0":"=r" (__tmp)); \
+	if ((__next->tss.cr3 || smp_num_cpus > 1) && \
+	    __next->tss.cr3 != __tmp) \
+		__asm__ __volatile__("movl %0,%%cr3"::"r" (__next->tss.cr3)); \
+	__asm__ __volatile__("lldt %%ax"::"a" (__next->tss.ldt)); \
+	if (cpu_last_math[__cpu] == __next) \
+		__asm__ __volatile__("clts"); \
+	else { \
+		__asm__("movl %%cr0,%0":"=r" (__tmp)); \
+		if (!(__tmp & 8)) \
+			__asm__ __volatile__("movl %0,%%cr0"::"r" (__tmp | 8)); \
+	} \
+	__asm__ __volatile__("pushfl\n\t" \
+		"pushl %%ebp\n\t" \
+		"push %%fs\n\t" \
+		"push %%gs\n\t" \
+		"movl %%esp,%c4(%%eax)\n\t" \
+		"movl $1f,%c5(%%eax)\n\t" \
+		"movl %c4(%%ecx),%%esp\n\t" \
+		"jmp *%c5(%%ecx)\n" \
+		"1:\tpop %%gs\n\t" \
+		"pop %%fs\n\t" \
+		"popl %%ebp\n\t" \
+		"popfl" \
+		:"=a" (__d0),"=c" (__d1) \
+		:"0" (current),"1" (__next),"i" (TSS_ESP),"i" (TSS_EIP) \
+		:"bx","dx","si","di","memory"); \
+} \
+} while (0)
 
 #define PAGE_ALIGN(n) (((n)+0xfff)&0xfffff000)
 
@@ -0,0 +1,18 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+/*
+ * A slab cache hands out objects of one size, carved out of whole pages.
+ * The constructor (if any) is run once for every object when its page is
+ * added to the cache, and objects are expected to be given back in the
+ * same state, so it isn't paid for on every allocation.
+ */
+struct kmem_cache;
+
+extern struct kmem_cache * kmem_cache_create(const char * name, int size,
+	void (*ctor)(void *));
+extern void * kmem_cache_alloc(struct kmem_cache * cachep, int priority);
+extern void kmem_cache_free(struct kmem_cache * cachep, void * objp);
+extern void kmem_cache_stats(void);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef _SMP_H
+#define _SMP_H
+
+/*
+ * The boot cpu is cpu 0, the others are numbered as they come up, see
+ * kernel/smp.c. Without an MP table smp_num_cpus stays 1, and the rest
+ * of this is just a little overhead.
+ */
+#define NR_CPUS 4
+
+struct task_struct;
+
+extern int smp_num_cpus;
+extern struct task_struct * cpu_curr[NR_CPUS];
+
+#define smp_processor_id() (current->processor)
+
+extern void smp_init(void);
+extern void smp_wake_idle(void);
+extern void smp_invalidate(void);
+
+/*
+ * The kernel lock: only one cpu at a time runs kernel code outside of
+ * spinlocked sections and the tlb flush interrupt. It is taken on every
+ * way into the kernel, and stays with the task across schedule(), so it
+ * nests: lock_depth in the task struct counts how deep.
+ */
+extern void lock_kernel(void);
+extern void unlock_kernel(void);
+
+#endif
@@ -72,6 +72,16 @@ extern int sys_setreuid();
 extern int sys_setregid();
 extern int sys_iam();
 extern int sys_whoami();
+extern int sys_swapon();
+extern int sys_gettimeofday();
+extern int sys_clock_gettime();
+extern int sys_nanosleep();
+extern int sys_sched_setscheduler();
+extern int sys_sched_getscheduler();
+extern int sys_select();
+extern int sys_poll();
+extern int sys_syslog();
+extern int sys_trace();
 
 // 信号处理流程
 // 系统调用表 先从sys_call_table获取
@@ -87,4 +97,7 @@ sys_getgid, sys_signal, sys_geteuid, sys_getegid, sys_acct, sys_phys,
 sys_lock, sys_ioctl, sys_fcntl, sys_mpx, sys_setpgid, sys_ulimit,
 sys_uname, sys_umask, sys_chroot, sys_ustat, sys_dup2, sys_getppid,
 sys_getpgrp, sys_setsid, sys_sigaction, sys_sgetmask, sys_ssetmask,
-sys_setreuid,sys_setregid, sys_iam, sys_whoami };
\ No newline at end of file
+sys_setreuid,sys_setregid, sys_iam, sys_whoami, sys_swapon,
+sys_gettimeofday, sys_clock_gettime, sys_nanosleep, sys_sched_setscheduler,
+sys_sched_getscheduler, sys_select, sys_poll,
+sys_syslog, sys_trace };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/*
+ * Kernel tracepoints. With CONFIG_TRACE (see TRACE in Makefile.header)
+ * each tracepoint() puts an event in a ring in kernel/trace.c, stamped
+ * with the time stamp counter, and trace() reads them out. Without it
+ * tracepoint() is nothing at all. tools/tracedump.c decodes a dump.
+ */
+struct trace_event {
+	unsigned long long tsc;		/* jiffies if there is no TSC */
+	unsigned char type;
+	unsigned char cpu;
+	unsigned short pid;
+	long a, b;
+};
+
+/* event types, and what is in a and b */
+#define TR_SWITCH	1	/* pid switched to, state of the one before */
+#define TR_SYSCALL	2	/* syscall number */
+#define TR_SYSRET	3	/* return value */
+#define TR_REQUEST	4	/* dev, sector: queued by make_request() */
+#define TR_END_REQUEST	5	/* dev, sector; b is -1 on an error */
+#define TR_GETBLK_HIT	6	/* dev, block */
+#define TR_GETBLK_MISS	7	/* dev, block */
+#define TR_NO_PAGE	8	/* address */
+#define TR_WP_PAGE	9	/* address */
+
+/* trace() commands */
+#define TRACE_READ	0	/* read and remove up to 'count' events */
+#define TRACE_CLEAR	1	/* throw away what is there */
+#define TRACE_STOP	2
+#define TRACE_START	3
+#define TRACE_KHZ	4	/* TSC kHz, 0 if the stamps are jiffies */
+
+#ifdef CONFIG_TRACE
+extern void trace_event(int type, long a, long b);
+#define tracepoint(type,a,b) trace_event((type),(long) (a),(long) (b))
+#else
+#define tracepoint(type,a,b) do { } while (0)
+#endif
+
+#endif
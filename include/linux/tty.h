@@ -1,9 +1,8 @@
 /*
  * 'tty.h' defines some structures used by tty_io.c and some defines.
  *
- * NOTE! Don't touch this without checking that nothing in rs_io.s or
- * con_io.s breaks. Some constants are hardwired into the system (mainly
- * offsets into 'tty_queue'
+ * NOTE! rs_io.s and kb.S get the offsets into 'tty_queue' from
+ * tty_offsets.c, so the Makefile remakes them when this changes.
  */
 
 #ifndef _TTY_H
@@ -13,25 +12,32 @@
 
 #define TTY_BUF_SIZE 1024
 
+/*
+ * Each queue has a buffer of its own, of a power of two in size, see
+ * tty_io.c. 'overruns' counts the input characters that were lost, to
+ * a full queue or to the UART.
+ */
 struct tty_queue {
 	unsigned long data;
 	unsigned long head;
 	unsigned long tail;
-	struct task_struct * proc_list;
-	char buf[TTY_BUF_SIZE];
+	struct wait_queue * proc_list;
+	unsigned long mask;		/* size-1 */
+	char * buf;
+	unsigned long overruns;
 };
 
-#define INC(a) ((a) = ((a)+1) & (TTY_BUF_SIZE-1))
-#define DEC(a) ((a) = ((a)-1) & (TTY_BUF_SIZE-1))
+#define INC(q,a) ((q).a = ((q).a+1) & (q).mask)
+#define DEC(q,a) ((q).a = ((q).a-1) & (q).mask)
 #define EMPTY(a) ((a).head == (a).tail)
-#define LEFT(a) (((a).tail-(a).head-1)&(TTY_BUF_SIZE-1))
-#define LAST(a) ((a).buf[(TTY_BUF_SIZE-1)&((a).head-1)])
+#define LEFT(a) (((a).tail-(a).head-1)&(a).mask)
+#define LAST(a) ((a).buf[(a).mask&((a).head-1)])
 #define FULL(a) (!LEFT(a))
-#define CHARS(a) (((a).head-(a).tail)&(TTY_BUF_SIZE-1))
+#define CHARS(a) (((a).head-(a).tail)&(a).mask)
 #define GETCH(queue,c) \
-(void)({c=(queue).buf[(queue).tail];INC((queue).tail);})
+(void)({c=(queue).buf[(queue).tail];INC((queue),tail);})
 #define PUTCH(c,queue) \
-(void)({(queue).buf[(queue).head]=(c);INC((queue).head);})
+(void)({(queue).buf[(queue).head]=(c);INC((queue),head);})
 
 #define INTR_CHAR(tty) ((tty)->termios.c_cc[VINTR])
 #define QUIT_CHAR(tty) ((tty)->termios.c_cc[VQUIT])
@@ -50,8 +56,26 @@ struct tty_struct {
 	struct tty_queue read_q;
 	struct tty_queue write_q;
 	struct tty_queue secondary;
+	unsigned char special[32];	/* see tty_set_special() */
+	int hung_up;			/* its pty master is gone */
 	};
 
+/*
+ * tty_table has the first console, the two serial lines, the slave
+ * sides of the ptys and then the other consoles: the minor of a
+ * /dev/ttyx is its index. The master of a pty has the minor of its
+ * slave plus PTY_MASTER, see pty.c.
+ */
+#define NR_CONSOLES	8
+#define NR_PTYS		32
+#define PTY_MINOR	3		/* the first slave */
+#define CON_MINOR	(PTY_MINOR+NR_PTYS)	/* the second console */
+#define NR_TTYS		(CON_MINOR+NR_CONSOLES-1)
+#define PTY_MASTER	128
+
+#define IS_PTY(minor)	((minor) >= PTY_MINOR && (minor) < CON_MINOR)
+#define CONSOLE(nr)	((nr) ? CON_MINOR+(nr)-1 : 0)	/* its minor */
+
 extern struct tty_struct tty_table[];
 
 /*	intr=^C		quit=^|		erase=del	kill=^U
@@ -65,13 +89,24 @@ extern struct tty_struct tty_table[];
 void rs_init(void);
 void con_init(void);
 void tty_init(void);
+void pty_init(void);
+void init_tty(struct tty_struct * tty, void (*write)(struct tty_struct * tty),
+	char * buf, int size);
 
-int tty_read(unsigned c, char * buf, int n);
+int tty_read(unsigned c, char * buf, int n, int flags);
 int tty_write(unsigned c, char * buf, int n);
 
 void rs_write(struct tty_struct * tty);
+void pty_write(struct tty_struct * tty);
+int pty_master_read(unsigned minor, char * buf, int nr, int flags);
+int pty_master_write(unsigned minor, char * buf, int nr, int flags);
+void pty_open(unsigned minor);
+void pty_close(unsigned minor);
+void change_speed(struct tty_struct * tty);
 void con_write(struct tty_struct * tty);
 
 void copy_to_cooked(struct tty_struct * tty);
+void tty_set_special(struct tty_struct * tty);
+void tty_intr(struct tty_struct * tty, int mask);
 
 #endif
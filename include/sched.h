@@ -0,0 +1,26 @@
+#ifndef _POSIX_SCHED_H
+#define _POSIX_SCHED_H
+
+#include <sys/types.h>
+
+/*
+ * Real-time tasks always run before SCHED_OTHER ones, the highest
+ * sched_priority (1-99) first. A SCHED_FIFO task keeps the cpu until it
+ * blocks, SCHED_RR ones of the same priority take turns.
+ */
+#define SCHED_OTHER	0
+#define SCHED_FIFO	1
+#define SCHED_RR	2
+
+#define SCHED_PRIO_MIN	1
+#define SCHED_PRIO_MAX	99
+
+struct sched_param {
+	int sched_priority;
+};
+
+extern int sched_setscheduler(pid_t pid, int policy,
+	const struct sched_param * param);
+extern int sched_getscheduler(pid_t pid);
+
+#endif
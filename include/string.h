@@ -27,6 +27,7 @@ extern char * strerror(int errno);
 extern inline char * strcpy(char * dest,const char *src);
 extern inline char * strcat(char * dest,const char * src);
 extern inline int strcmp(const char * cs,const char * ct);
+extern inline int strncmp(const char * cs,const char * ct,int count);
 extern inline int strspn(const char * cs, const char * ct);
 extern inline int strcspn(const char * cs, const char * ct);
 extern inline char * strpbrk(const char * cs,const char * ct);
@@ -44,4 +45,5 @@ extern inline char * strtok(char * s,const char * ct);
 extern inline void * memcpy(void * dest,const void * src, int n);
 extern inline void * memmove(void * dest,const void * src, int n);
 extern inline void * memchr(const void * cs,char c,int count);
+extern inline void * memset(void * s,char c,int count);
 #endif
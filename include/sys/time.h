@@ -0,0 +1,36 @@
+#ifndef _SYS_TIME_H
+#define _SYS_TIME_H
+
+#include <sys/types.h>
+
+struct timeval {
+	time_t tv_sec;
+	long tv_usec;
+};
+
+struct timezone {
+	int tz_minuteswest;
+	int tz_dsttime;
+};
+
+/*
+ * A descriptor set has a bit for each of up to FD_SETSIZE descriptors.
+ * Only three arguments come in registers, so the system call takes a
+ * pointer to the five of select().
+ */
+#define FD_SETSIZE	32
+
+typedef struct {
+	unsigned long fds_bits[FD_SETSIZE/32];
+} fd_set;
+
+#define FD_ZERO(set)	((set)->fds_bits[0] = 0)
+#define FD_SET(fd,set)	((set)->fds_bits[0] |= 1UL << (fd))
+#define FD_CLR(fd,set)	((set)->fds_bits[0] &= ~(1UL << (fd)))
+#define FD_ISSET(fd,set) (((set)->fds_bits[0] >> (fd)) & 1)
+
+extern int gettimeofday(struct timeval * tp, struct timezone * tz);
+extern int select(int n, fd_set * readfds, fd_set * writefds,
+	fd_set * exceptfds, struct timeval * timeout);
+
+#endif
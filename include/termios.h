@@ -32,6 +32,8 @@
 #define TIOCGSOFTCAR	0x5419
 #define TIOCSSOFTCAR	0x541A
 #define TIOCINQ		0x541B
+#define FIONREAD	TIOCINQ
+#define TIOCGOVERRUN	0x541C	/* input characters lost so far */
 
 struct winsize {
 	unsigned short ws_row;
@@ -129,7 +131,7 @@ struct termios {
 #define   FF1	0040000
 
 /* c_cflag bit meaning */
-#define CBAUD	0000017
+#define CBAUD	0010017
 #define  B0	0000000		/* hang up */
 #define  B50	0000001
 #define  B75	0000002
@@ -148,6 +150,9 @@ struct termios {
 #define  B38400	0000017
 #define EXTA B19200
 #define EXTB B38400
+#define CBAUDEX	0010000
+#define  B57600	0010001
+#define  B115200 0010002
 #define CSIZE	0000060
 #define   CS5	0000000
 #define   CS6	0000020
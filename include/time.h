@@ -15,6 +15,14 @@ typedef unsigned int size_t;
 
 typedef long clock_t;
 
+struct timespec {
+	time_t tv_sec;
+	long tv_nsec;
+};
+
+#define CLOCK_REALTIME	0
+#define CLOCK_MONOTONIC	1
+
 struct tm {
 	int tm_sec;
 	int tm_min;
@@ -39,4 +47,7 @@ struct tm *localtime(const time_t * tp);
 size_t strftime(char * s, size_t smax, const char * fmt, const struct tm * tp);
 void tzset(void);
 
+int clock_gettime(int clock_id, struct timespec * tp);
+int nanosleep(const struct timespec * rqtp, struct timespec * rmtp);
+
 #endif
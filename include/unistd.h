@@ -131,12 +131,31 @@
 #define __NR_setregid	71
 #define __NR_iam		72
 #define __NR_whoami		73
+#define __NR_swapon		74
+#define __NR_gettimeofday	75
+#define __NR_clock_gettime	76
+#define __NR_nanosleep	77
+#define __NR_sched_setscheduler	78
+#define __NR_sched_getscheduler	79
+#define __NR_select	80
+#define __NR_poll	81
+#define __NR_syslog	82
+#define __NR_trace	83
+
+/*
+ * System calls go through __syscall_vector, which is int 0x80, or
+ * sysenter on cpus that have it (see lib/syscall.c). Code that mustn't
+ * touch the user stack defines __SYSCALL as "int $0x80" instead.
+ */
+#ifndef __SYSCALL
+#define __SYSCALL "call *__syscall_vector"
+#endif
 
 #define _syscall0(type,name) \
   type name(void) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL \
 	: "=a" (__res) \
 	: "0" (__NR_##name)); \
 if (__res >= 0) \
@@ -149,7 +168,7 @@ return -1; \
 type name(atype a) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a))); \
 if (__res >= 0) \
@@ -162,7 +181,7 @@ return -1; \
 type name(atype a,btype b) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b))); \
 if (__res >= 0) \
@@ -175,7 +194,7 @@ return -1; \
 type name(atype a,btype b,ctype c) \
 { \
 long __res; \
-__asm__ volatile ("int $0x80" \
+__asm__ volatile (__SYSCALL \
 	: "=a" (__res) \
 	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c))); \
 if (__res>=0) \
@@ -226,6 +245,7 @@ int nice(int val);
 int open(const char * filename, int flag, ...);
 static int pause(void);
 int pipe(int * fildes);
+int profil(char * buf, int bufsiz, int offset, int scale);
 int read(int fildes, char * buf, off_t count);
 int setpgrp(void);
 int setpgid(pid_t pid,pid_t pgid);
@@ -5,6 +5,7 @@
  */
 
 #define __LIBRARY__
+#define __SYSCALL "int $0x80"	/* no stack use, see below */
 #include <unistd.h>
 #include <time.h>
 
@@ -52,13 +53,17 @@ extern void floppy_init(void);
 extern void mem_init(long start, long end);
 extern long rd_init(long mem_start, int length);
 extern long kernel_mktime(struct tm * tm);
+extern void tsc_init(void);
 extern long startup_time;
+extern char etext;
 
 /*
  * This is set up by the setup-routine at boot-time
  */
 #define EXT_MEM_K (*(unsigned short *)0x90002)
+#define ALT_MEM_K (*(unsigned long *)0x901E0)
 #define DRIVE_INFO (*(struct drive_info *)0x90080)
+#define ORIG_SCHED_CLASS (*(unsigned short *)0x901FA)
 #define ORIG_ROOT_DEV (*(unsigned short *)0x901FC)
 
 /*
@@ -95,6 +100,7 @@ static void time_init(void)
 	BCD_TO_BIN(time.tm_year);
 	time.tm_mon--;
 	startup_time = kernel_mktime(&time);
+	tsc_init();
 }
 
 static long memory_end = 0;
@@ -105,6 +111,8 @@ struct drive_info { char dummy[32]; } drive_info;
 
 void main(void)		/* This really IS void, no error here. */
 {			/* The startup routine assumes (well, ...) this */
+	unsigned long i;
+
 /*
  * Interrupts are still disabled. Do necessary setups, then
  * enable them
@@ -112,16 +120,19 @@ void main(void)		/* This really IS void, no error here. */
 // 系统初始化
    // 设置操作系统的根文件
  	ROOT_DEV = ORIG_ROOT_DEV;
+	sched_fair = (ORIG_SCHED_CLASS == 1);
    // 设置操作系统的操作参数
  	drive_info = DRIVE_INFO;
    // 解析setup.s 代码后获取系统内存参数
    // 设置系统的内存大小 本身内存1M+扩展内存大小(参数大小*kb)
 	memory_end = (1<<20) + (EXT_MEM_K<<10);
+	if (ALT_MEM_K > EXT_MEM_K)
+		memory_end = (1<<20) + (ALT_MEM_K<<10);
 	// 取整4K的内存大小
 	memory_end &= 0xfffff000;
-	// 控制操作系统的最大内存为16M
-	if (memory_end > 16*1024*1024)
-		memory_end = 16*1024*1024;
+	// 内核只映射了前1G的物理内存
+	if (memory_end > TASK_BASE)
+		memory_end = TASK_BASE;
 	// 设置高速缓冲区的大小	
 	if (memory_end > 12*1024*1024) 
 		buffer_memory_end = 4*1024*1024;
@@ -131,6 +142,11 @@ void main(void)		/* This really IS void, no error here. */
 		buffer_memory_end = 1*1024*1024;
 	// 主内存开始=高速缓冲区的结束 用户程序开始的地方
 	main_memory_start = buffer_memory_end;
+	prof_buffer = (unsigned long *) main_memory_start;
+	prof_len = (unsigned long) &etext >> PROFILE_SHIFT;
+	for (i = 0 ; i < prof_len ; i++)
+		prof_buffer[i] = 0;
+	main_memory_start += (prof_len*sizeof(long) + 4095) & 0xfffff000;
 #ifdef RAMDISK
     // 虚拟磁盘 
 	main_memory_start += rd_init(main_memory_start, RAMDISK*1024);
@@ -143,8 +159,11 @@ void main(void)		/* This really IS void, no error here. */
 	time_init();
 	sched_init();
 	buffer_init(buffer_memory_end);
+	inode_init();
+	file_table_init();
 	hd_init();
 	floppy_init();
+	smp_init();
 	sti();
 	// 从内核态切换到用户态
 	move_to_user_mode();
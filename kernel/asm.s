@@ -9,6 +9,7 @@
  * page_exception is handled by the mm, so that isn't here. This
  * file also handles (hopefully) fpu-exceptions due to TS-bit, as
  * the fpu must be properly saved/resored. This hasn't been tested.
+ * The handlers are called with the kernel lock held.
  */
 
 .globl divide_error,debug,nmi,int3,overflow,bounds,invalid_op
@@ -36,8 +37,11 @@ no_error_code:
 	mov %dx,%ds
 	mov %dx,%es
 	mov %dx,%fs
-	call *%eax
+	movl %eax,%ebx
+	call lock_kernel
+	call *%ebx
 	addl $8,%esp
+	call unlock_kernel
 	pop %fs
 	pop %es
 	pop %ds
@@ -92,6 +96,7 @@ irq13:
 1:	jmp 1f
 1:	outb %al,$0xA0
 	popl %eax
+	call apic_eoi
 	jmp coprocessor_error
 
 double_fault:
@@ -114,8 +119,10 @@ error_code:
 	mov %ax,%ds
 	mov %ax,%es
 	mov %ax,%fs
+	call lock_kernel
 	call *%ebx
 	addl $8,%esp
+	call unlock_kernel
 	pop %fs
 	pop %es
 	pop %ds
@@ -144,3 +151,5 @@ general_protection:
 	pushl $do_general_protection
 	jmp error_code
 
+
+.section .note.GNU-stack,"",@progbits
@@ -1,11 +1,13 @@
 #ifndef _BLK_H
 #define _BLK_H
 
+#include <linux/trace.h>
+
 #define NR_BLK_DEV	7
 /*
- * NR_REQUEST is the number of entries in the request-queue.
- * NOTE that writes may use only the low 2/3 of these: reads
- * take precedence.
+ * NR_REQUEST is the number of requests that may be queued at once.
+ * NOTE that writes may use only 2/3 of these: reads take precedence.
+ * The requests themselves come from a slab cache.
  *
  * 32 seems to be a reasonable number: enough to get some benefit
  * from the elevator-mechanism, but not so much as to lock a lot of
@@ -21,13 +23,13 @@
  * read/write completion.
  */
 struct request {
-	int dev;		/* -1 if no request */
+	int dev;
 	int cmd;		/* READ or WRITE */
 	int errors;
 	unsigned long sector;
 	unsigned long nr_sectors;
 	char * buffer;
-	struct task_struct * waiting;
+	struct wait_queue * waiting;
 	struct buffer_head * bh;
 	struct request * next;
 };
@@ -42,14 +44,18 @@ struct request {
 ((s1)->dev < (s2)->dev || ((s1)->dev == (s2)->dev && \
 (s1)->sector < (s2)->sector))))
 
+/*
+ * 'lock' is held while requests are put on the list and taken off it:
+ * the driver itself only looks at the head.
+ */
 struct blk_dev_struct {
 	void (*request_fn)(void);
 	struct request * current_request;
+	spinlock_t lock;
 };
 
 extern struct blk_dev_struct blk_dev[NR_BLK_DEV];
-extern struct request request[NR_REQUEST];
-extern struct task_struct * wait_for_request;
+extern void free_request(struct request * req);
 
 #ifdef MAJOR_NR
 
@@ -100,15 +106,23 @@ static void (DEVICE_REQUEST)(void);
 
 static inline void unlock_buffer(struct buffer_head * bh)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&buffer_lock,flags);
 	if (!bh->b_lock)
 		printk(DEVICE_NAME ": free buffer being unlocked\n");
 	bh->b_lock=0;
-	wake_up(&bh->b_wait);
+	wake_up_one(&bh->b_wait);
+	spin_unlock_irqrestore(&buffer_lock,flags);
 }
 
 static inline void end_request(int uptodate)
 {
+	struct request * req;
+	unsigned long flags;
+
 	DEVICE_OFF(CURRENT->dev);
+	tracepoint(TR_END_REQUEST,CURRENT->dev,uptodate ? CURRENT->sector : -1);
 	if (CURRENT->bh) {
 		CURRENT->bh->b_uptodate = uptodate;
 		unlock_buffer(CURRENT->bh);
@@ -118,10 +132,12 @@ static inline void end_request(int uptodate)
 		printk("dev %04x, block %d\n\r",CURRENT->dev,
 			CURRENT->bh->b_blocknr);
 	}
-	wake_up(&CURRENT->waiting);
-	wake_up(&wait_for_request);
-	CURRENT->dev = -1;
-	CURRENT = CURRENT->next;
+	wake_up_all(&CURRENT->waiting);
+	spin_lock_irqsave(&blk_dev[MAJOR_NR].lock,flags);
+	req = CURRENT;
+	CURRENT = req->next;
+	spin_unlock_irqrestore(&blk_dev[MAJOR_NR].lock,flags);
+	free_request(req);
 }
 
 #define INIT_REQUEST \
@@ -120,14 +120,14 @@ static unsigned char seek_track = 0;
 static unsigned char current_track = 255;
 static unsigned char command = 0;
 unsigned char selected = 0;
-struct task_struct * wait_on_floppy_select = NULL;
+struct wait_queue * wait_on_floppy_select = NULL;
 
 void floppy_deselect(unsigned int nr)
 {
 	if (nr != (current_DOR & 3))
 		printk("floppy_deselect: drive not selected\n\r");
 	selected = 0;
-	wake_up(&wait_on_floppy_select);
+	wake_up_all(&wait_on_floppy_select);
 }
 
 /*
@@ -10,68 +10,82 @@
 #include <errno.h>
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
 #include <asm/system.h>
 
 #include "blk.h"
 
 /*
  * The request-struct contains all necessary data
- * to load a nr of sectors into memory
+ * to load a nr of sectors into memory. They come from
+ * request_cachep, nr_requests are in use.
  */
-struct request request[NR_REQUEST];
+static struct kmem_cache * request_cachep;
+static int nr_requests = 0;
 
 /*
- * used to wait on when there are no free requests
+ * used to wait on when there are no free requests. request_lock
+ * covers it and nr_requests.
  */
-struct task_struct * wait_for_request = NULL;
+static struct wait_queue * wait_for_request = NULL;
+static spinlock_t request_lock = SPIN_LOCK_UNLOCKED;
 
 /* blk_dev_struct is:
  *	do_request-address
  *	next-request
+ *	the lock of the request list
  */
 struct blk_dev_struct blk_dev[NR_BLK_DEV] = {
-	{ NULL, NULL },		/* no_dev */
-	{ NULL, NULL },		/* dev mem */
-	{ NULL, NULL },		/* dev fd */
-	{ NULL, NULL },		/* dev hd */
-	{ NULL, NULL },		/* dev ttyx */
-	{ NULL, NULL },		/* dev tty */
-	{ NULL, NULL }		/* dev lp */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED },	/* no_dev */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED },	/* dev mem */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED },	/* dev fd */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED },	/* dev hd */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED },	/* dev ttyx */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED },	/* dev tty */
+	{ NULL, NULL, SPIN_LOCK_UNLOCKED }	/* dev lp */
 };
 
 static inline void lock_buffer(struct buffer_head * bh)
 {
-	cli();
+	unsigned long flags;
+
+	spin_lock_irqsave(&buffer_lock,flags);
 	while (bh->b_lock)
-		sleep_on(&bh->b_wait);
+		sleep_on_exclusive_unlock(&bh->b_wait,&buffer_lock);
 	bh->b_lock=1;
-	sti();
+	spin_unlock_irqrestore(&buffer_lock,flags);
 }
 
 static inline void unlock_buffer(struct buffer_head * bh)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&buffer_lock,flags);
 	if (!bh->b_lock)
 		printk("ll_rw_block.c: buffer not locked\n\r");
 	bh->b_lock = 0;
-	wake_up(&bh->b_wait);
+	wake_up_one(&bh->b_wait);
+	spin_unlock_irqrestore(&buffer_lock,flags);
 }
 
 /*
  * add-request adds a request to the linked list.
- * It disables interrupts so that it can muck with the
- * request-lists in peace.
+ * It takes the lock of the list so that it can muck with
+ * it in peace: end_request() takes it off again.
  */
 static void add_request(struct blk_dev_struct * dev, struct request * req)
 {
 	struct request * tmp;
+	unsigned long flags;
 
 	req->next = NULL;
-	cli();
+	spin_lock_irqsave(&dev->lock,flags);
 	if (req->bh)
 		req->bh->b_dirt = 0;
 	if (!(tmp = dev->current_request)) {
 		dev->current_request = req;
-		sti();
+		spin_unlock_irqrestore(&dev->lock,flags);
 		(dev->request_fn)();
 		return;
 	}
@@ -82,12 +96,13 @@ static void add_request(struct blk_dev_struct * dev, struct request * req)
 			break;
 	req->next=tmp->next;
 	tmp->next=req;
-	sti();
+	spin_unlock_irqrestore(&dev->lock,flags);
 }
 
 static void make_request(int major,int rw, struct buffer_head * bh)
 {
 	struct request * req;
+	unsigned long flags;
 	int rw_ahead;
 
 /* WRITEA/READA is special case - it is not really needed, so if the */
@@ -107,28 +122,26 @@ static void make_request(int major,int rw, struct buffer_head * bh)
 		unlock_buffer(bh);
 		return;
 	}
-repeat:
 /* we don't allow the write-requests to fill up the queue completely:
  * we want some room for reads: they take precedence. The last third
  * of the requests are only for reads.
+ * The allocation is atomic: we may be swapping out, and the cache
+ * always has room for NR_REQUEST requests anyway.
  */
-	if (rw == READ)
-		req = request+NR_REQUEST;
-	else
-		req = request+((NR_REQUEST*2)/3);
-/* find an empty request */
-	while (--req >= request)
-		if (req->dev<0)
-			break;
-/* if none found, sleep on new requests: check for rw_ahead */
-	if (req < request) {
+	spin_lock_irqsave(&request_lock,flags);
+	while (nr_requests >= (rw == READ ? NR_REQUEST : (NR_REQUEST*2)/3) ||
+	    !(req = (struct request *)
+	    kmem_cache_alloc(request_cachep,GFP_ATOMIC))) {
+/* if none free, sleep on new requests: check for rw_ahead */
 		if (rw_ahead) {
+			spin_unlock_irqrestore(&request_lock,flags);
 			unlock_buffer(bh);
 			return;
 		}
-		sleep_on(&wait_for_request);
-		goto repeat;
+		sleep_on_exclusive_unlock(&wait_for_request,&request_lock);
 	}
+	nr_requests++;
+	spin_unlock_irqrestore(&request_lock,flags);
 /* fill up the request-info, and add it to the queue */
 	req->dev = bh->b_dev;
 	req->cmd = rw;
@@ -139,6 +152,7 @@ repeat:
 	req->waiting = NULL;
 	req->bh = bh;
 	req->next = NULL;
+	tracepoint(TR_REQUEST,req->dev,req->sector);
 	add_request(major+blk_dev,req);
 }
 
@@ -154,12 +168,24 @@ void ll_rw_block(int rw, struct buffer_head * bh)
 	make_request(major,rw,bh);
 }
 
-void blk_dev_init(void)
+/*
+ * free_request() is called by end_request() from the interrupt
+ * routines. The wake-up is under request_lock, so it can't come
+ * between make_request() seeing no room and going to sleep.
+ */
+void free_request(struct request * req)
 {
-	int i;
+	unsigned long flags;
 
-	for (i=0 ; i<NR_REQUEST ; i++) {
-		request[i].dev = -1;
-		request[i].next = NULL;
-	}
+	spin_lock_irqsave(&request_lock,flags);
+	kmem_cache_free(request_cachep,req);
+	nr_requests--;
+	wake_up_one(&wait_for_request);
+	spin_unlock_irqrestore(&request_lock,flags);
+}
+
+void blk_dev_init(void)
+{
+	request_cachep = kmem_cache_create("request",
+		sizeof(struct request),NULL);
 }
@@ -13,13 +13,19 @@
  * Hopefully this will be a rather complete VT102 implementation.
  *
  * Beeping thanks to John T Kohl.
+ *
+ * There are NR_CONSOLES virtual consoles, each with a state of its own
+ * and a page to keep its screen in. The one in the foreground is in
+ * video memory; the others write to their page, so they never touch
+ * the video card. Alt-Fn switches, see change_console().
  */
 
 /*
- *  NOTE!!! We sometimes disable and enable interrupts for a short while
- * (to put a word in video IO), but this will work even for keyboard
- * interrupts. We know interrupts aren't enabled when getting a keyboard
- * interrupt, as we use trap-gates. Hopefully all is well.
+ *  NOTE!!! We sometimes disable interrupts for a short while (to put a
+ * word in video IO), and put back what they were after, so this works
+ * from the timer too. The keyboard interrupt is a trap gate, and can
+ * come in the middle of con_write(): that is why it doesn't switch
+ * consoles itself, see change_console().
  */
 
 /*
@@ -29,6 +35,8 @@
 
 #include <linux/sched.h>
 #include <linux/tty.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
 #include <asm/io.h>
 #include <asm/system.h>
 
@@ -54,6 +62,7 @@
 #define NPAR 16
 
 extern void keyboard_interrupt(void);
+extern struct tty_queue * table_list[];
 
 static unsigned char	video_type;		/* Type of display being used	*/
 static unsigned long	video_num_columns;	/* Number of text columns	*/
@@ -66,17 +75,50 @@ static unsigned short	video_port_reg;		/* Video register select port	*/
 static unsigned short	video_port_val;		/* Video register value port	*/
 static unsigned short	video_erase_char;	/* Char+Attrib to erase with	*/
 
-static unsigned long	origin;		/* Used for EGA/VGA fast scroll	*/
-static unsigned long	scr_end;	/* Used for EGA/VGA fast scroll	*/
-static unsigned long	pos;
-static unsigned long	x,y;
-static unsigned long	top,bottom;
-static unsigned long	state=0;
-static unsigned long	npar,par[NPAR];
-static unsigned long	ques=0;
-static unsigned char	attr=0x07;
+static unsigned long	video_screen_size;	/* Bytes per screen		*/
+
+static struct vc {
+	unsigned long	vc_origin;	/* Used for EGA/VGA fast scroll	*/
+	unsigned long	vc_scr_end;	/* Used for EGA/VGA fast scroll	*/
+	unsigned long	vc_pos;
+	unsigned long	vc_x,vc_y;
+	unsigned long	vc_top,vc_bottom;
+	unsigned long	vc_state;
+	unsigned long	vc_npar,vc_par[NPAR];
+	unsigned long	vc_ques;
+	unsigned char	vc_attr;
+	int		vc_saved_x;
+	int		vc_saved_y;
+	unsigned long	vc_screenbuf;	/* the screen, in the background */
+} vc_cons[NR_CONSOLES];
+
+#define origin		(vc_cons[currcons].vc_origin)
+#define scr_end		(vc_cons[currcons].vc_scr_end)
+#define pos		(vc_cons[currcons].vc_pos)
+#define x		(vc_cons[currcons].vc_x)
+#define y		(vc_cons[currcons].vc_y)
+#define top		(vc_cons[currcons].vc_top)
+#define bottom		(vc_cons[currcons].vc_bottom)
+#define state		(vc_cons[currcons].vc_state)
+#define npar		(vc_cons[currcons].vc_npar)
+#define par		(vc_cons[currcons].vc_par)
+#define ques		(vc_cons[currcons].vc_ques)
+#define attr		(vc_cons[currcons].vc_attr)
+#define saved_x		(vc_cons[currcons].vc_saved_x)
+#define saved_y		(vc_cons[currcons].vc_saved_y)
+#define screenbuf	(vc_cons[currcons].vc_screenbuf)
+
+int fg_console = 0;
+static int nr_consoles = 1;	/* those with a page */
+static volatile int con_busy = 0;	/* in con_write() or console_print() */
+static volatile int want_console = -1;	/* Alt-Fn asked for it */
+
+#define CON_BUF_SIZE TTY_BUF_SIZE
+
+static char con_queue_buf[NR_CONSOLES-1][3*CON_BUF_SIZE];
 
 static void sysbeep(void);
+static void switch_console(void);
 
 /*
  * this is what the terminal answers to a ESC-Z or csi0c
@@ -85,7 +127,7 @@ static void sysbeep(void);
 #define RESPONSE "\033[?1;2c"
 
 /* NOTE! gotoxy thinks x==video_num_columns is ok */
-static inline void gotoxy(unsigned int new_x,unsigned int new_y)
+static inline void gotoxy(int currcons, unsigned int new_x,unsigned int new_y)
 {
 	if (new_x > video_num_columns || new_y >= video_num_lines)
 		return;
@@ -94,80 +136,79 @@ static inline void gotoxy(unsigned int new_x,unsigned int new_y)
 	pos=origin + y*video_size_row + (x<<1);
 }
 
-static inline void set_origin(void)
+static inline void set_origin(int currcons)
 {
+	unsigned long flags;
+
+	if (currcons != fg_console)
+		return;
+	save_flags(flags);
 	cli();
 	outb_p(12, video_port_reg);
 	outb_p(0xff&((origin-video_mem_start)>>9), video_port_val);
 	outb_p(13, video_port_reg);
 	outb_p(0xff&((origin-video_mem_start)>>1), video_port_val);
-	sti();
+	restore_flags(flags);
 }
 
-static void scrup(void)
+/*
+ * scrup() scrolls the region up 'nr' lines in one go. The origin is only
+ * moved here: con_write() tells the video card once it is done.
+ */
+static void scrup(int currcons, unsigned int nr)
 {
-	if (video_type == VIDEO_TYPE_EGAC || video_type == VIDEO_TYPE_EGAM)
+	if (nr > bottom-top)
+		nr = bottom-top;
+	if ((video_type == VIDEO_TYPE_EGAC || video_type == VIDEO_TYPE_EGAM) &&
+	    currcons == fg_console && !top && bottom == video_num_lines)
 	{
-		if (!top && bottom == video_num_lines) {
-			origin += video_size_row;
-			pos += video_size_row;
-			scr_end += video_size_row;
-			if (scr_end > video_mem_end) {
-				__asm__("cld\n\t"
-					"rep\n\t"
-					"movsl\n\t"
-					"movl video_num_columns,%1\n\t"
-					"rep\n\t"
-					"stosw"
-					::"a" (video_erase_char),
-					"c" ((video_num_lines-1)*video_num_columns>>1),
-					"D" (video_mem_start),
-					"S" (origin)
-					);
-				scr_end -= origin-video_mem_start;
-				pos -= origin-video_mem_start;
-				origin = video_mem_start;
-			} else {
-				__asm__("cld\n\t"
-					"rep\n\t"
-					"stosw"
-					::"a" (video_erase_char),
-					"c" (video_num_columns),
-					"D" (scr_end-video_size_row)
-					);
-			}
-			set_origin();
-		} else {
+		origin += nr*video_size_row;
+		pos += nr*video_size_row;
+		scr_end += nr*video_size_row;
+		if (scr_end > video_mem_end) {
 			__asm__("cld\n\t"
 				"rep\n\t"
 				"movsl\n\t"
-				"movl video_num_columns,%%ecx\n\t"
+				"movl %%edx,%%ecx\n\t"
+				"rep\n\t"
+				"stosw"
+				::"a" (video_erase_char),
+				"c" ((video_num_lines-nr)*video_num_columns>>1),
+				"d" (nr*video_num_columns),
+				"D" (video_mem_start),
+				"S" (origin)
+				);
+			scr_end -= origin-video_mem_start;
+			pos -= origin-video_mem_start;
+			origin = video_mem_start;
+		} else {
+			__asm__("cld\n\t"
 				"rep\n\t"
 				"stosw"
 				::"a" (video_erase_char),
-				"c" ((bottom-top-1)*video_num_columns>>1),
-				"D" (origin+video_size_row*top),
-				"S" (origin+video_size_row*(top+1))
+				"c" (nr*video_num_columns),
+				"D" (scr_end-nr*video_size_row)
 				);
 		}
 	}
-	else		/* Not EGA/VGA */
+	else		/* Not EGA/VGA, or not all of the screen */
 	{
 		__asm__("cld\n\t"
 			"rep\n\t"
 			"movsl\n\t"
-			"movl video_num_columns,%%ecx\n\t"
+			"movl %%edx,%%ecx\n\t"
 			"rep\n\t"
 			"stosw"
 			::"a" (video_erase_char),
-			"c" ((bottom-top-1)*video_num_columns>>1),
+			"c" ((bottom-top-nr)*video_num_columns>>1),
+			"d" (nr*video_num_columns),
 			"D" (origin+video_size_row*top),
-			"S" (origin+video_size_row*(top+1))
+			"S" (origin+video_size_row*(top+nr))
 			);
 	}
 }
 
-static void scrdown(void)
+static void scrdown(int currcons)
 {
 	if (video_type == VIDEO_TYPE_EGAC || video_type == VIDEO_TYPE_EGAM)
 	{
@@ -201,33 +242,33 @@ static void scrdown(void)
 	}
 }
 
-static void lf(void)
+static void lf(int currcons)
 {
 	if (y+1<bottom) {
 		y++;
 		pos += video_size_row;
 		return;
 	}
-	scrup();
+	scrup(currcons,1);
 }
 
-static void ri(void)
+static void ri(int currcons)
 {
 	if (y>top) {
 		y--;
 		pos -= video_size_row;
 		return;
 	}
-	scrdown();
+	scrdown(currcons);
 }
 
-static void cr(void)
+static void cr(int currcons)
 {
 	pos -= x<<1;
 	x=0;
 }
 
-static void del(void)
+static void del(int currcons)
 {
 	if (x) {
 		pos -= 2;
@@ -236,12 +277,12 @@ static void del(void)
 	}
 }
 
-static void csi_J(int par)
+static void csi_J(int currcons, int vpar)
 {
 	long count;
 	long start;
 
-	switch (par) {
+	switch (vpar) {
 		case 0:	/* erase from cursor to end of display */
 			count = (scr_end-pos)>>1;
 			start = pos;
@@ -265,12 +306,12 @@ static void csi_J(int par)
 		);
 }
 
-static void csi_K(int par)
+static void csi_K(int currcons, int vpar)
 {
 	long count;
 	long start;
 
-	switch (par) {
+	switch (vpar) {
 		case 0:	/* erase from cursor to end of line */
 			if (x>=video_num_columns)
 				return;
@@ -296,7 +337,7 @@ static void csi_K(int par)
 		);
 }
 
-void csi_m(void)
+static void csi_m(int currcons)
 {
 	int i;
 
@@ -310,14 +351,19 @@ void csi_m(void)
 		}
 }
 
-static inline void set_cursor(void)
+static inline void set_cursor(int currcons)
 {
+	unsigned long flags;
+
+	if (currcons != fg_console)
+		return;
+	save_flags(flags);
 	cli();
 	outb_p(14, video_port_reg);
 	outb_p(0xff&((pos-video_mem_start)>>9), video_port_val);
 	outb_p(15, video_port_reg);
 	outb_p(0xff&((pos-video_mem_start)>>1), video_port_val);
-	sti();
+	restore_flags(flags);
 }
 
 static void respond(struct tty_struct * tty)
@@ -333,7 +379,7 @@ static void respond(struct tty_struct * tty)
 	copy_to_cooked(tty);
 }
 
-static void insert_char(void)
+static void insert_char(int currcons)
 {
 	int i=x;
 	unsigned short tmp, old = video_erase_char;
@@ -347,7 +393,7 @@ static void insert_char(void)
 	}
 }
 
-static void insert_line(void)
+static void insert_line(int currcons)
 {
 	int oldtop,oldbottom;
 
@@ -355,12 +401,12 @@ static void insert_line(void)
 	oldbottom=bottom;
 	top=y;
 	bottom = video_num_lines;
-	scrdown();
+	scrdown(currcons);
 	top=oldtop;
 	bottom=oldbottom;
 }
 
-static void delete_char(void)
+static void delete_char(int currcons)
 {
 	int i;
 	unsigned short * p = (unsigned short *) pos;
@@ -375,7 +421,7 @@ static void delete_char(void)
 	*p = video_erase_char;
 }
 
-static void delete_line(void)
+static void delete_line(int currcons, unsigned int nr)
 {
 	int oldtop,oldbottom;
 
@@ -383,71 +429,130 @@ static void delete_line(void)
 	oldbottom=bottom;
 	top=y;
 	bottom = video_num_lines;
-	scrup();
+	scrup(currcons,nr);
 	top=oldtop;
 	bottom=oldbottom;
 }
 
-static void csi_at(unsigned int nr)
+static void csi_at(int currcons, unsigned int nr)
 {
 	if (nr > video_num_columns)
 		nr = video_num_columns;
 	else if (!nr)
 		nr = 1;
 	while (nr--)
-		insert_char();
+		insert_char(currcons);
 }
 
-static void csi_L(unsigned int nr)
+static void csi_L(int currcons, unsigned int nr)
 {
 	if (nr > video_num_lines)
 		nr = video_num_lines;
 	else if (!nr)
 		nr = 1;
 	while (nr--)
-		insert_line();
+		insert_line(currcons);
 }
 
-static void csi_P(unsigned int nr)
+static void csi_P(int currcons, unsigned int nr)
 {
 	if (nr > video_num_columns)
 		nr = video_num_columns;
 	else if (!nr)
 		nr = 1;
 	while (nr--)
-		delete_char();
+		delete_char(currcons);
 }
 
-static void csi_M(unsigned int nr)
+static void csi_M(int currcons, unsigned int nr)
 {
 	if (nr > video_num_lines)
 		nr = video_num_lines;
 	else if (!nr)
 		nr=1;
-	while (nr--)
-		delete_line();
+	delete_line(currcons,nr);
 }
 
-static int saved_x=0;
-static int saved_y=0;
-
-static void save_cur(void)
+static void save_cur(int currcons)
 {
 	saved_x=x;
 	saved_y=y;
 }
 
-static void restore_cur(void)
+static void restore_cur(int currcons)
 {
-	gotoxy(saved_x, saved_y);
+	gotoxy(currcons, saved_x, saved_y);
 }
 
+/*
+ * put_run() writes 'c', and the printable characters after it in 'q',
+ * straight to the screen, as far as the line goes. It returns how many
+ * it took from the queue, out of the 'nr' there are.
+ */
+static int put_run(int currcons, char c, struct tty_queue * q, int nr)
+{
+	unsigned short * p = (unsigned short *) pos;
+	unsigned short a = attr << 8;
+	int room = video_num_columns - x, n = 0;
+
+	for (;;) {
+		*p++ = a | (unsigned char) c;
+		if (!--room || n == nr)
+			break;
+		c = q->buf[q->tail];
+		if (c<32 || c>126)
+			break;
+		INC(*q,tail);
+		n++;
+	}
+	x += n+1;
+	pos += (n+1)<<1;
+	return n;
+}
+
+/*
+ * lf_ahead() counts the line feeds in the first 'nr' characters of 'q',
+ * up to 'max', as long as there is nothing but text, CR, BS and TAB in
+ * between: from the bottom line, each of those will scroll.
+ */
+static int lf_ahead(struct tty_queue * q, int nr, int max)
+{
+	unsigned long i = q->tail;
+	int n = 0;
+	char c;
+
+	while (nr-- > 0 && n < max) {
+		c = q->buf[i];
+		i = (i+1) & q->mask;
+		if (c==10 || c==11 || c==12)
+			n++;
+		else if (c<32 && c!=13 && c!=8 && c!=9)
+			break;
+	}
+	return n;
+}
+
+/*
+ * con_write() takes runs of text straight to the screen, and a line
+ * feed on the bottom line scrolls for those that follow it too, all at
+ * once. The cursor and the origin are only set once, at the end.
+ */
 void con_write(struct tty_struct * tty)
 {
-	int nr;
+	int nr, n, currcons;
+	unsigned long old_origin;
 	char c;
 
+	currcons = tty - tty_table;
+	if (currcons)
+		currcons -= CON_MINOR-1;
 	nr = CHARS(tty->write_q);
+	if (currcons >= nr_consoles) {
+		tty->write_q.tail = tty->write_q.head;
+		return;
+	}
+	con_busy++;
+	old_origin = origin;
 	while (nr--) {
 		GETCH(tty->write_q,c);
 		switch(state) {
@@ -456,22 +561,23 @@ void con_write(struct tty_struct * tty)
 					if (x>=video_num_columns) {
 						x -= video_num_columns;
 						pos -= video_size_row;
-						lf();
+						lf(currcons);
 					}
-					__asm__("movb attr,%%ah\n\t"
-						"movw %%ax,%1\n\t"
-						::"a" (c),"m" (*(short *)pos)
-						);
-					pos += 2;
-					x++;
+					nr -= put_run(currcons,c,&tty->write_q,nr);
 				} else if (c==27)
 					state=1;
-				else if (c==10 || c==11 || c==12)
-					lf();
-				else if (c==13)
-					cr();
+				else if (c==10 || c==11 || c==12) {
+					if (y+1 == bottom && (n = lf_ahead(
+					    &tty->write_q,nr,bottom-top-1))) {
+						scrup(currcons,n+1);
+						y -= n;
+						pos -= n*video_size_row;
+					} else
+						lf(currcons);
+				} else if (c==13)
+					cr(currcons);
 				else if (c==ERASE_CHAR(tty))
-					del();
+					del(currcons);
 				else if (c==8) {
 					if (x) {
 						x--;
@@ -484,7 +590,7 @@ void con_write(struct tty_struct * tty)
 					if (x>video_num_columns) {
 						x -= video_num_columns;
 						pos -= video_size_row;
-						lf();
+						lf(currcons);
 					}
 					c=9;
 				} else if (c==7)
@@ -495,17 +601,17 @@ void con_write(struct tty_struct * tty)
 				if (c=='[')
 					state=2;
 				else if (c=='E')
-					gotoxy(0,y+1);
+					gotoxy(currcons,0,y+1);
 				else if (c=='M')
-					ri();
+					ri(currcons);
 				else if (c=='D')
-					lf();
+					lf(currcons);
 				else if (c=='Z')
 					respond(tty);
 				else if (x=='7')
-					save_cur();
+					save_cur(currcons);
 				else if (x=='8')
-					restore_cur();
+					restore_cur(currcons);
 				break;
 			case 2:
 				for(npar=0;npar<NPAR;npar++)
@@ -527,61 +633,61 @@ void con_write(struct tty_struct * tty)
 				switch(c) {
 					case 'G': case '`':
 						if (par[0]) par[0]--;
-						gotoxy(par[0],y);
+						gotoxy(currcons,par[0],y);
 						break;
 					case 'A':
 						if (!par[0]) par[0]++;
-						gotoxy(x,y-par[0]);
+						gotoxy(currcons,x,y-par[0]);
 						break;
 					case 'B': case 'e':
 						if (!par[0]) par[0]++;
-						gotoxy(x,y+par[0]);
+						gotoxy(currcons,x,y+par[0]);
 						break;
 					case 'C': case 'a':
 						if (!par[0]) par[0]++;
-						gotoxy(x+par[0],y);
+						gotoxy(currcons,x+par[0],y);
 						break;
 					case 'D':
 						if (!par[0]) par[0]++;
-						gotoxy(x-par[0],y);
+						gotoxy(currcons,x-par[0],y);
 						break;
 					case 'E':
 						if (!par[0]) par[0]++;
-						gotoxy(0,y+par[0]);
+						gotoxy(currcons,0,y+par[0]);
 						break;
 					case 'F':
 						if (!par[0]) par[0]++;
-						gotoxy(0,y-par[0]);
+						gotoxy(currcons,0,y-par[0]);
 						break;
 					case 'd':
 						if (par[0]) par[0]--;
-						gotoxy(x,par[0]);
+						gotoxy(currcons,x,par[0]);
 						break;
 					case 'H': case 'f':
 						if (par[0]) par[0]--;
 						if (par[1]) par[1]--;
-						gotoxy(par[1],par[0]);
+						gotoxy(currcons,par[1],par[0]);
 						break;
 					case 'J':
-						csi_J(par[0]);
+						csi_J(currcons,par[0]);
 						break;
 					case 'K':
-						csi_K(par[0]);
+						csi_K(currcons,par[0]);
 						break;
 					case 'L':
-						csi_L(par[0]);
+						csi_L(currcons,par[0]);
 						break;
 					case 'M':
-						csi_M(par[0]);
+						csi_M(currcons,par[0]);
 						break;
 					case 'P':
-						csi_P(par[0]);
+						csi_P(currcons,par[0]);
 						break;
 					case '@':
-						csi_at(par[0]);
+						csi_at(currcons,par[0]);
 						break;
 					case 'm':
-						csi_m();
+						csi_m(currcons);
 						break;
 					case 'r':
 						if (par[0]) par[0]--;
@@ -593,15 +699,62 @@ void con_write(struct tty_struct * tty)
 						}
 						break;
 					case 's':
-						save_cur();
+						save_cur(currcons);
 						break;
 					case 'u':
-						restore_cur();
+						restore_cur(currcons);
 						break;
 				}
 		}
 	}
-	set_cursor();
+	if (origin != old_origin)
+		set_origin(currcons);
+	set_cursor(currcons);
+	con_busy--;
+	switch_console();
+}
+
+/*
+ * console_print() puts kernel messages on the foreground console for
+ * printk.c. It doesn't go through a tty queue, so it can be called from
+ * the timer, and it knows no control characters but LF and CR. If the
+ * timer came in con_write(), it prints nothing and returns -1: the
+ * messages have to wait for the next tick.
+ */
+int console_print(const char * b, int count)
+{
+	int currcons = fg_console;
+	unsigned long old_origin = origin;
+	char c;
+
+	if (con_busy)
+		return -1;
+	con_busy++;
+	while (count-- > 0) {
+		c = *b++;
+		if (c == 10) {
+			lf(currcons);
+			continue;
+		}
+		if (c == 13) {
+			cr(currcons);
+			continue;
+		}
+		if (x >= video_num_columns) {
+			x -= video_num_columns;
+			pos -= video_size_row;
+			lf(currcons);
+		}
+		*(unsigned short *) pos = (attr << 8) | (unsigned char) c;
+		pos += 2;
+		x++;
+	}
+	if (origin != old_origin)
+		set_origin(currcons);
+	set_cursor(currcons);
+	con_busy--;
+	switch_console();
+	return 0;
 }
 
 /*
@@ -619,12 +772,15 @@ void con_init(void)
 	register unsigned char a;
 	char *display_desc = "????";
 	char *display_ptr;
+	int currcons;
+	unsigned long i;
 
 	video_num_columns = ORIG_VIDEO_COLS;
 	video_size_row = video_num_columns * 2;
 	video_num_lines = ORIG_VIDEO_LINES;
 	video_page = ORIG_VIDEO_PAGE;
 	video_erase_char = 0x0720;
+	video_screen_size = video_num_lines * video_size_row;
 	
 	if (ORIG_VIDEO_MODE == 7)			/* Is this a monochrome display? */
 	{
@@ -674,18 +830,107 @@ void con_init(void)
 	
 	/* Initialize the variables used for scrolling (mostly EGA/VGA)	*/
 	
-	origin	= video_mem_start;
-	scr_end	= video_mem_start + video_num_lines * video_size_row;
-	top	= 0;
-	bottom	= video_num_lines;
-
-	gotoxy(ORIG_X,ORIG_Y);
+	for (currcons = 0 ; currcons < NR_CONSOLES ; currcons++) {
+		if (video_screen_size <= PAGE_SIZE)
+			screenbuf = get_free_page();
+		if (currcons && !screenbuf)
+			break;
+		origin	= currcons ? screenbuf : video_mem_start;
+		scr_end	= origin + video_screen_size;
+		top	= 0;
+		bottom	= video_num_lines;
+		state	= 0;
+		ques	= 0;
+		attr	= 0x07;
+		saved_x	= saved_y = 0;
+		gotoxy(currcons,0,0);
+		if (!screenbuf)
+			break;
+		for (i = 0 ; i < video_screen_size ; i += 2)
+			*(unsigned short *) (screenbuf+i) = video_erase_char;
+		nr_consoles = currcons+1;
+	}
+	for (currcons = 1 ; currcons < NR_CONSOLES ; currcons++)
+		init_tty(tty_table+CONSOLE(currcons),con_write,
+			con_queue_buf[currcons-1],CON_BUF_SIZE);
+	currcons = 0;
+	gotoxy(currcons,ORIG_X,ORIG_Y);
+	if (nr_consoles < NR_CONSOLES)
+		printk("Only %d consoles\n\r",nr_consoles);
 	set_trap_gate(0x21,&keyboard_interrupt);
 	outb_p(inb_p(0x21)&0xfd,0x21);
 	a=inb_p(0x61);
 	outb_p(a|0x80,0x61);
 	outb(a,0x61);
 }
+
+/*
+ * change_console() is called from the keyboard interrupt on Alt-Fn. It
+ * only asks for the switch: if the interrupt came in con_write(), the
+ * origin and pos it would move are half way through being changed, and
+ * con_write() does the switch itself when it is done.
+ */
+void change_console(unsigned int new_console)
+{
+	if (new_console < nr_consoles)
+		want_console = new_console;
+	switch_console();
+}
+
+/*
+ * switch_console() does the switch asked for, if nobody is writing to
+ * a console. The visible page of the old console goes to its buffer,
+ * and that of the new one to the start of video memory. Nothing else
+ * has to move, as each writes wherever its origin is.
+ */
+static void switch_console(void)
+{
+	unsigned long flags;
+	int currcons = fg_console;
+
+	save_flags(flags);
+	cli();
+	if (con_busy || want_console < 0) {
+		restore_flags(flags);
+		return;
+	}
+	if (want_console == fg_console) {
+		want_console = -1;
+		restore_flags(flags);
+		return;
+	}
+	__asm__("cld\n\t"
+		"rep\n\t"
+		"movsw"
+		::"c" (video_screen_size>>1),
+		"D" (screenbuf),"S" (origin)
+		);
+	pos += screenbuf - origin;
+	origin = screenbuf;
+	scr_end = origin + video_screen_size;
+	currcons = fg_console = want_console;
+	want_console = -1;
+	__asm__("cld\n\t"
+		"rep\n\t"
+		"movsw"
+		::"c" (video_screen_size>>1),
+		"D" (video_mem_start),"S" (origin)
+		);
+	pos += video_mem_start - origin;
+	origin = video_mem_start;
+	scr_end = origin + video_screen_size;
+	set_origin(currcons);
+	set_cursor(currcons);
+	table_list[0] = &tty_table[CONSOLE(currcons)].read_q;
+	restore_flags(flags);
+}
+
+/* the keyboard interrupt has put something in the foreground console */
+void do_con_interrupt(void)
+{
+	copy_to_cooked(tty_table+CONSOLE(fg_console));
+}
+
 /* from bsd-net-2: */
 
 void sysbeepstop(void)
@@ -0,0 +1,232 @@
+/*
+ *  linux/kernel/chr_drv/pty.c
+ */
+
+/*
+ * Pseudo ttys. The slave of a pty is an ordinary tty in tty_table, with
+ * the line discipline of tty_io.c. The master isn't a tty at all: what
+ * is written to it goes straight into the read_q of the slave and on
+ * through copy_to_cooked(), and reading it takes what the slave wrote
+ * (or echoed) straight out of the slave's write_q. Both copy in runs.
+ *
+ * A master writer waits on the read_q of the slave for tty_read() to
+ * make room in secondary. A master reader waits on the write_q, with
+ * any slave writer waiting for room there.
+ *
+ * pty_open() and pty_close() count the opens of the two sides. When the
+ * last master goes the slave is hung up: its process group gets SIGHUP,
+ * tty_read() gives what is left and then EOF, and tty_write() -EIO.
+ * When the last slave goes the master reads -EIO once it has had what
+ * was left. A pair starts out with empty queues whenever it is opened
+ * with neither side open.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+#include <linux/sched.h>
+#include <linux/tty.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define PTY_BUF_SIZE TTY_BUF_SIZE
+
+static char pty_buf[NR_PTYS][3*PTY_BUF_SIZE];
+static int master_count[NR_PTYS], slave_count[NR_PTYS];
+static char slave_gone[NR_PTYS];	/* was open, and all have closed */
+
+void pty_init(void)
+{
+	int i;
+
+	for (i=0 ; i<NR_PTYS ; i++)
+		init_tty(tty_table+PTY_MINOR+i,pty_write,pty_buf[i],
+			PTY_BUF_SIZE);
+}
+
+/* the slave has written something: it's there for the master to read */
+void pty_write(struct tty_struct * tty)
+{
+	wake_up_all(&tty->write_q.proc_list);
+}
+
+static struct tty_struct * master_tty(unsigned minor)
+{
+	minor &= ~PTY_MASTER;
+	if (!IS_PTY(minor))
+		return NULL;
+	return tty_table + minor;
+}
+
+static void flush(struct tty_queue * queue)
+{
+	queue->head = queue->tail = queue->data = 0;
+}
+
+void pty_open(unsigned minor)
+{
+	struct tty_struct * tty;
+	int i;
+
+	if (!(tty = master_tty(minor)))
+		return;
+	i = tty - tty_table - PTY_MINOR;
+	if (!master_count[i] && !slave_count[i]) {
+		cli();
+		flush(&tty->read_q);
+		flush(&tty->write_q);
+		flush(&tty->secondary);
+		tty->pgrp = 0;
+		tty->stopped = 0;
+		tty->hung_up = 0;
+		slave_gone[i] = 0;
+		sti();
+	}
+	if (minor & PTY_MASTER)
+		master_count[i]++;
+	else {
+		slave_count[i]++;
+		slave_gone[i] = 0;
+	}
+}
+
+void pty_close(unsigned minor)
+{
+	struct tty_struct * tty;
+	int i;
+
+	if (!(tty = master_tty(minor)))
+		return;
+	i = tty - tty_table - PTY_MINOR;
+	if (minor & PTY_MASTER) {
+		if (!master_count[i] || --master_count[i])
+			return;
+		cli();
+		tty->hung_up = 1;
+		flush(&tty->write_q);		/* nobody will read it now */
+		sti();
+		tty_intr(tty,1<<(SIGHUP-1));
+		wake_up_all(&tty->secondary.proc_list);
+		wake_up_all(&tty->write_q.proc_list);
+	} else {
+		if (!slave_count[i] || --slave_count[i])
+			return;
+		slave_gone[i] = 1;
+		wake_up_all(&tty->write_q.proc_list);
+		wake_up_all(&tty->read_q.proc_list);
+	}
+}
+
+int pty_master_read(unsigned minor, char * buf, int nr, int flags)
+{
+	struct tty_struct * tty;
+	struct tty_queue * queue;
+	char * b = buf;
+	int i, chars;
+
+	if (!(tty = master_tty(minor)) || nr<0)
+		return -ENODEV;
+	i = tty - tty_table - PTY_MINOR;
+	queue = &tty->write_q;
+	while (nr>0) {
+		if (!(chars = CHARS(*queue))) {
+			if (b!=buf || current->signal || slave_gone[i] ||
+			    (flags & O_NONBLOCK))
+				break;
+			cli();
+			while (!current->signal && !slave_gone[i] &&
+			       EMPTY(*queue))
+				interruptible_sleep_on(&queue->proc_list);
+			sti();
+			continue;
+		}
+		if (chars > queue->mask+1 - queue->tail)
+			chars = queue->mask+1 - queue->tail;
+		if (chars > nr)
+			chars = nr;
+		nr -= chars;
+		while (chars-->0)
+			put_fs_byte(queue->buf[queue->tail++],b++);
+		queue->tail &= queue->mask;
+	}
+	if (b-buf) {
+		wake_up_all(&queue->proc_list);
+		return b-buf;
+	}
+	if (slave_gone[i])
+		return -EIO;
+	if (current->signal)
+		return -EINTR;
+	return (flags & O_NONBLOCK) ? -EAGAIN : 0;
+}
+
+int pty_master_write(unsigned minor, char * buf, int nr, int flags)
+{
+	struct tty_struct * tty;
+	struct tty_queue * queue;
+	char * b = buf;
+	int i, chars;
+
+	if (!(tty = master_tty(minor)) || nr<0)
+		return -ENODEV;
+	i = tty - tty_table - PTY_MINOR;
+	if (slave_gone[i])
+		return -EIO;
+	queue = &tty->read_q;
+	while (nr>0) {
+		copy_to_cooked(tty);
+		if (!(chars = LEFT(*queue))) {
+			if (current->signal || slave_gone[i] ||
+			    (flags & O_NONBLOCK))
+				break;
+			cli();
+			if (FULL(tty->secondary) && !slave_gone[i])
+				interruptible_sleep_on(&queue->proc_list);
+			sti();
+			continue;
+		}
+		if (chars > queue->mask+1 - queue->head)
+			chars = queue->mask+1 - queue->head;
+		if (chars > nr)
+			chars = nr;
+		nr -= chars;
+		while (chars-->0)
+			queue->buf[queue->head++] = get_fs_byte(b++);
+		queue->head &= queue->mask;
+	}
+	copy_to_cooked(tty);
+	if (b-buf)
+		return b-buf;
+	if (current->signal)
+		return -EINTR;
+	return (flags & O_NONBLOCK) ? -EAGAIN : 0;
+}
+
+/*
+ * The master is readable when the slave has written something, and
+ * writable when there is room in the slave's read_q. It is hung up when
+ * the slave has been closed.
+ */
+int pty_master_poll(unsigned minor, int events, struct poll_table * pt)
+{
+	struct tty_struct * tty;
+	int mask = 0;
+
+	if (!(tty = master_tty(minor)))
+		return POLLERR;
+	if (events & POLLIN) {
+		poll_wait(&tty->write_q.proc_list,pt);
+		if (!EMPTY(tty->write_q))
+			mask |= POLLIN;
+	}
+	if (events & POLLOUT) {
+		poll_wait(&tty->read_q.proc_list,pt);
+		if (!FULL(tty->read_q))
+			mask |= POLLOUT;
+	}
+	if (slave_gone[tty - tty_table - PTY_MINOR])
+		mask |= POLLHUP;
+	return mask;
+}
@@ -13,16 +13,8 @@
 .text
 .globl rs1_interrupt,rs2_interrupt
 
-size	= 1024				/* must be power of two !
-					   and must match the value
-					   in tty_io.c!!! */
-
-/* these are the offsets into the read/write buffer structures */
-rs_addr = 0
-head = 4
-tail = 8
-proc_list = 12
-buf = 16
+/* the offsets into the read/write buffer structures */
+.include "tty_offsets.inc"
 
 startup	= 256		/* chars left in write queue when we restart it */
 
@@ -48,6 +40,7 @@ rs_int:
 	pop %ds
 	pushl $0x10
 	pop %es
+	call lock_kernel
 	movl 24(%esp),%edx
 	movl (%edx),%edx
 	movl rs_addr(%edx),%edx
@@ -57,7 +50,11 @@ rep_int:
 	inb %dx,%al
 	testb $1,%al
 	jne end
-	cmpb $6,%al		/* this shouldn't happen, but ... */
+	andb $0x0e,%al		/* drop the FIFO bits */
+	cmpb $0x0c,%al		/* character timeout: read them */
+	jne 1f
+	movb $4,%al
+1:	cmpb $6,%al		/* this shouldn't happen, but ... */
 	ja end
 	movl 24(%esp),%ecx
 	pushl %edx
@@ -67,6 +64,11 @@ rep_int:
 	jmp rep_int
 end:	movb $0x20,%al
 	outb %al,$0x20		/* EOI */
+	call apic_eoi
+	pushl 32(%esp)		/* the interrupted cs */
+	call intr_resched
+	addl $4,%esp
+	call unlock_kernel
 	pop %ds
 	pop %es
 	popl %eax
@@ -79,6 +81,24 @@ end:	movb $0x20,%al
 jmp_table:
 	.long modem_status,write_char,read_char,line_status
 
+/*
+ * wake_up_proc wakes everybody on the proc_list of the queue in %ecx.
+ * Only %eax is changed.
+ */
+.align 2
+wake_up_proc:
+	cmpl $0,proc_list(%ecx)		# is there any?
+	je 1f
+	pushl %ecx
+	pushl %edx
+	leal proc_list(%ecx),%eax
+	pushl %eax
+	call wake_up_all
+	addl $4,%esp
+	popl %edx
+	popl %ecx
+1:	ret
+
 .align 2
 modem_status:
 	addl $6,%edx		/* clear intr by reading modem status reg */
@@ -89,59 +109,92 @@ modem_status:
 line_status:
 	addl $5,%edx		/* clear intr by reading line status reg. */
 	inb %dx,%al
-	ret
+	testb $2,%al		/* overrun */
+	je 1f
+	movl (%ecx),%ecx
+	incl overruns(%ecx)
+1:	ret
 
+/*
+ * read_char takes all there is in the receive FIFO before it hands it
+ * to the line discipline.
+ */
 .align 2
 read_char:
-	inb %dx,%al
-	movl %ecx,%edx
-	subl $table_list,%edx
-	shrl $3,%edx
+	pushl %esi
+	movl %ecx,%eax
+	subl $table_list,%eax
+	shrl $3,%eax
+	pushl %eax			# tty nr, for do_tty_interrupt
 	movl (%ecx),%ecx		# read-queue
+	movl buf(%ecx),%esi
+1:	inb %dx,%al
 	movl head(%ecx),%ebx
-	movb %al,buf(%ecx,%ebx)
+	movb %al,(%esi,%ebx)
 	incl %ebx
-	andl $size-1,%ebx
+	andl mask(%ecx),%ebx
 	cmpl tail(%ecx),%ebx
-	je 1f
+	je 2f
 	movl %ebx,head(%ecx)
-1:	pushl %edx
+	jmp 3f
+2:	incl overruns(%ecx)		# queue full
+3:	addl $5,%edx			# line status
+	inb %dx,%al
+	subl $5,%edx
+	testb $2,%al			# overrun
+	je 4f
+	incl overruns(%ecx)
+4:	testb $1,%al			# more data?
+	jne 1b
 	call do_tty_interrupt
 	addl $4,%esp
+	popl %esi
 	ret
 
+/*
+ * write_char fills the transmit FIFO, rs_xmit_fifo[tty] characters.
+ */
 .align 2
 write_char:
+	pushl %esi
+	pushl %edi
+	movl %ecx,%eax
+	subl $table_list,%eax
+	shrl $3,%eax
+	movl rs_xmit_fifo(,%eax,4),%esi
 	movl 4(%ecx),%ecx		# write-queue
+	movl buf(%ecx),%edi
 	movl head(%ecx),%ebx
 	subl tail(%ecx),%ebx
-	andl $size-1,%ebx		# nr chars in queue
-	je write_buffer_empty
+	andl mask(%ecx),%ebx		# nr chars in queue
+	je 3f
 	cmpl $startup,%ebx
 	ja 1f
-	movl proc_list(%ecx),%ebx	# wake up sleeping process
-	testl %ebx,%ebx			# is there any?
-	je 1f
-	movl $0,(%ebx)
+	call wake_up_proc		# wake up sleeping processes
 1:	movl tail(%ecx),%ebx
-	movb buf(%ecx,%ebx),%al
+2:	movb (%edi,%ebx),%al
 	outb %al,%dx
 	incl %ebx
-	andl $size-1,%ebx
-	movl %ebx,tail(%ecx)
+	andl mask(%ecx),%ebx
 	cmpl head(%ecx),%ebx
-	je write_buffer_empty
+	je 4f
+	decl %esi
+	jne 2b
+	movl %ebx,tail(%ecx)
+	popl %edi
+	popl %esi
 	ret
-.align 2
+4:	movl %ebx,tail(%ecx)
+3:	popl %edi
+	popl %esi
 write_buffer_empty:
-	movl proc_list(%ecx),%ebx	# wake up sleeping process
-	testl %ebx,%ebx			# is there any?
-	je 1f
-	movl $0,(%ebx)
-1:	incl %edx
+	call wake_up_proc		# wake up sleeping processes
+	incl %edx
 	inb %dx,%al
 	jmp 1f
 1:	jmp 1f
 1:	andb $0xd,%al		/* disable transmit interrupt */
 	outb %al,%dx
 	ret
+
+.section .note.GNU-stack,"",@progbits
@@ -11,6 +11,10 @@
  *	void rs_write(struct tty_struct * queue);
  *	void rs_init(void);
  * and all interrupts pertaining to serial IO.
+ *
+ * 16550A UARTs get their FIFOs turned on: rs_io.s then empties the
+ * receive FIFO and fills the transmit one on each interrupt. The speed
+ * and format come from the termios, see change_speed() in tty_ioctl.c.
  */
 
 #include <linux/tty.h>
@@ -20,16 +24,29 @@
 
 #define WAKEUP_CHARS (TTY_BUF_SIZE/4)
 
+/*
+ * The receive FIFO interrupts when it has this many characters, or when
+ * characters have waited 4 character times. 0x00, 0x40, 0x80 and 0xc0
+ * are 1, 4, 8 and 14: lower is fewer overruns, higher fewer interrupts.
+ */
+#define RX_TRIGGER 0x80
+
 extern void rs1_interrupt(void);
 extern void rs2_interrupt(void);
 
-static void init(int port)
+/* how many characters write_char may send at once, by tty */
+unsigned long rs_xmit_fifo[3] = {1,1,1};
+
+static void init(struct tty_struct * tty)
 {
-	outb_p(0x80,port+3);	/* set DLAB of line control reg */
-	outb_p(0x30,port);	/* LS of divisor (48 -> 2400 bps */
-	outb_p(0x00,port+1);	/* MS of divisor */
-	outb_p(0x03,port+3);	/* reset DLAB */
-	outb_p(0x0b,port+4);	/* set DTR,RTS, OUT_2 */
+	int port = tty->read_q.data;
+
+	outb_p(RX_TRIGGER | 0x07,port+2);	/* enable and clear FIFOs */
+	if ((inb_p(port+2) & 0xc0) == 0xc0)
+		rs_xmit_fifo[tty-tty_table] = 16;
+	else
+		outb_p(0x00,port+2);	/* none, or the broken 16550 one */
+	change_speed(tty);
 	outb_p(0x0d,port+1);	/* enable all intrs but writes */
 	(void)inb(port);	/* read data port to reset things (?) */
 }
@@ -38,8 +55,8 @@ void rs_init(void)
 {
 	set_intr_gate(0x24,rs1_interrupt);
 	set_intr_gate(0x23,rs2_interrupt);
-	init(tty_table[1].read_q.data);
-	init(tty_table[2].read_q.data);
+	init(tty_table+1);
+	init(tty_table+2);
 	outb(inb_p(0x21)&0xE7,0x21);
 }
 
@@ -13,6 +13,8 @@
 #include <ctype.h>
 #include <errno.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #define ALRMMASK (1<<(SIGALRM-1))
 #define KILLMASK (1<<(SIGKILL-1))
@@ -48,7 +50,25 @@
 #define O_NLRET(tty)	_O_FLAG((tty),ONLRET)
 #define O_LCUC(tty)	_O_FLAG((tty),OLCUC)
 
-struct tty_struct tty_table[] = {
+/*
+ * The queue sizes, powers of two. The serial lines get room for a few
+ * seconds of input at 38400 bps, so a busy system doesn't drop it.
+ */
+#define CON_QUEUE_SIZE		TTY_BUF_SIZE
+#define RS_READ_SIZE		16384
+#define RS_WRITE_SIZE		4096
+#define RS_SECONDARY_SIZE	16384
+
+static char con_read_buf[CON_QUEUE_SIZE], con_write_buf[CON_QUEUE_SIZE],
+	con_secondary_buf[CON_QUEUE_SIZE];
+static char rs1_read_buf[RS_READ_SIZE], rs1_write_buf[RS_WRITE_SIZE],
+	rs1_secondary_buf[RS_SECONDARY_SIZE];
+static char rs2_read_buf[RS_READ_SIZE], rs2_write_buf[RS_WRITE_SIZE],
+	rs2_secondary_buf[RS_SECONDARY_SIZE];
+
+#define QUEUE(data,buf) {data,0,0,NULL,sizeof(buf)-1,buf,0}
+
+struct tty_struct tty_table[NR_TTYS] = {
 	{
 		{ICRNL,		/* change incoming CR to NL */
 		OPOST|ONLCR,	/* change outgoing NL to CRNL */
@@ -59,9 +79,9 @@ struct tty_struct tty_table[] = {
 		0,			/* initial pgrp */
 		0,			/* initial stopped */
 		con_write,
-		{0,0,0,0,""},		/* console read-queue */
-		{0,0,0,0,""},		/* console write-queue */
-		{0,0,0,0,""}		/* console secondary queue */
+		QUEUE(0,con_read_buf),		/* console read-queue */
+		QUEUE(0,con_write_buf),		/* console write-queue */
+		QUEUE(0,con_secondary_buf)	/* console secondary queue */
 	},{
 		{0, /* no translation */
 		0,  /* no translation */
@@ -72,9 +92,9 @@ struct tty_struct tty_table[] = {
 		0,
 		0,
 		rs_write,
-		{0x3f8,0,0,0,""},		/* rs 1 */
-		{0x3f8,0,0,0,""},
-		{0,0,0,0,""}
+		QUEUE(0x3f8,rs1_read_buf),	/* rs 1 */
+		QUEUE(0x3f8,rs1_write_buf),
+		QUEUE(0,rs1_secondary_buf)
 	},{
 		{0, /* no translation */
 		0,  /* no translation */
@@ -85,16 +105,16 @@ struct tty_struct tty_table[] = {
 		0,
 		0,
 		rs_write,
-		{0x2f8,0,0,0,""},		/* rs 2 */
-		{0x2f8,0,0,0,""},
-		{0,0,0,0,""}
-	}
+		QUEUE(0x2f8,rs2_read_buf),	/* rs 2 */
+		QUEUE(0x2f8,rs2_write_buf),
+		QUEUE(0,rs2_secondary_buf)
+	}		/* the ptys and other consoles: see init_tty() */
 };
 
 /*
  * these are the tables used by the machine code handlers.
- * you can implement pseudo-tty's or something by changing
- * them. Currently not done.
+ * The first is the read queue of the console in the foreground,
+ * see change_console(). The ptys don't need them, see pty.c.
  */
 struct tty_queue * table_list[]={
 	&tty_table[0].read_q, &tty_table[0].write_q,
@@ -102,12 +122,79 @@ struct tty_queue * table_list[]={
 	&tty_table[2].read_q, &tty_table[2].write_q
 	};
 
+#define SPECIAL(tty,c) ((tty)->special[(unsigned char) (c) >> 3] & (1 << ((c) & 7)))
+#define SET_SPECIAL(tty,c) ((tty)->special[(unsigned char) (c) >> 3] |= 1 << ((c) & 7))
+
 void tty_init(void)
 {
+	int i;
+
+	for (i=0 ; i<PTY_MINOR ; i++)
+		tty_set_special(tty_table+i);
+	pty_init();
 	rs_init();
 	con_init();
 }
 
+static void init_queue(struct tty_queue * queue, char * buf, int size)
+{
+	queue->data = 0;
+	queue->head = queue->tail = 0;
+	queue->proc_list = NULL;
+	queue->mask = size-1;
+	queue->buf = buf;
+	queue->overruns = 0;
+}
+
+/*
+ * init_tty() sets up a tty that isn't filled in above, with the termios
+ * of the console and three queues of 'size' (a power of two) in 'buf'.
+ */
+void init_tty(struct tty_struct * tty, void (*write)(struct tty_struct * tty),
+	char * buf, int size)
+{
+	int i;
+
+	for (i=0 ; i<sizeof(struct termios) ; i++)
+		((char *)&tty->termios)[i] = ((char *)&tty_table[0].termios)[i];
+	tty->pgrp = 0;
+	tty->stopped = 0;
+	tty->hung_up = 0;
+	tty->write = write;
+	init_queue(&tty->read_q,buf,size);
+	init_queue(&tty->write_q,buf+size,size);
+	init_queue(&tty->secondary,buf+2*size,size);
+	tty_set_special(tty);
+}
+
+/*
+ * tty_set_special() marks the characters copy_to_cooked() has to look at
+ * one at a time under the current termios: control and 8-bit characters,
+ * the ones IUCLC translates, and those that have a c_cc meaning. It is
+ * called whenever the termios changes.
+ */
+void tty_set_special(struct tty_struct * tty)
+{
+	int i;
+
+	for (i=0 ; i<32 ; i++)
+		tty->special[i] = (i<4 || i>=16) ? 0xff : 0;
+	if (I_UCLC(tty))
+		for (i='A' ; i<='Z' ; i++)
+			SET_SPECIAL(tty,i);
+	SET_SPECIAL(tty,EOF_CHAR(tty));
+	if (L_CANON(tty)) {
+		SET_SPECIAL(tty,KILL_CHAR(tty));
+		SET_SPECIAL(tty,ERASE_CHAR(tty));
+		SET_SPECIAL(tty,STOP_CHAR(tty));
+		SET_SPECIAL(tty,START_CHAR(tty));
+	}
+	if (L_ISIG(tty)) {
+		SET_SPECIAL(tty,INTR_CHAR(tty));
+		SET_SPECIAL(tty,QUIT_CHAR(tty));
+	}
+}
+
 void tty_intr(struct tty_struct * tty, int mask)
 {
 	int i;
@@ -142,12 +229,44 @@ void wait_for_keypress(void)
 	sleep_if_empty(&tty_table[0].secondary);
 }
 
+/*
+ * echo_room() makes sure there is room for n characters of echo. The
+ * console empties write_q at once, a serial line only as it sends, so
+ * echo that doesn't fit there is lost.
+ */
+static int echo_room(struct tty_struct * tty, int n)
+{
+	if (LEFT(tty->write_q) < n)
+		tty->write(tty);
+	return LEFT(tty->write_q) >= n;
+}
+
+/*
+ * copy_to_cooked() takes runs of characters that are not special (see
+ * tty_set_special()) straight over to secondary and the echo, and only
+ * looks at the others one at a time. The driver is kicked once, at the
+ * end, for all of the echo.
+ */
 void copy_to_cooked(struct tty_struct * tty)
 {
 	signed char c;
+	int echo = 0;
 
 	while (!EMPTY(tty->read_q) && !FULL(tty->secondary)) {
-		GETCH(tty->read_q,c);
+		c = tty->read_q.buf[tty->read_q.tail];
+		if (!SPECIAL(tty,c)) {
+			do {
+				INC(tty->read_q,tail);
+				PUTCH(c,tty->secondary);
+				if (L_ECHO(tty) && echo_room(tty,1)) {
+					PUTCH(c,tty->write_q);
+					echo = 1;
+				}
+			} while (!EMPTY(tty->read_q) && !FULL(tty->secondary) &&
+			    !SPECIAL(tty,c = tty->read_q.buf[tty->read_q.tail]));
+			continue;
+		}
+		INC(tty->read_q,tail);
 		if (c==13)
 			if (I_CRNL(tty))
 				c=10;
@@ -164,13 +283,13 @@ void copy_to_cooked(struct tty_struct * tty)
 				while(!(EMPTY(tty->secondary) ||
 				        (c=LAST(tty->secondary))==10 ||
 				        c==EOF_CHAR(tty))) {
-					if (L_ECHO(tty)) {
+					if (L_ECHO(tty) && echo_room(tty,2)) {
 						if (c<32)
 							PUTCH(127,tty->write_q);
 						PUTCH(127,tty->write_q);
-						tty->write(tty);
+						echo = 1;
 					}
-					DEC(tty->secondary.head);
+					DEC(tty->secondary,head);
 				}
 				continue;
 			}
@@ -179,13 +298,13 @@ void copy_to_cooked(struct tty_struct * tty)
 				   (c=LAST(tty->secondary))==10 ||
 				   c==EOF_CHAR(tty))
 					continue;
-				if (L_ECHO(tty)) {
+				if (L_ECHO(tty) && echo_room(tty,2)) {
 					if (c<32)
 						PUTCH(127,tty->write_q);
 					PUTCH(127,tty->write_q);
-					tty->write(tty);
+					echo = 1;
 				}
-				DEC(tty->secondary.head);
+				DEC(tty->secondary,head);
 				continue;
 			}
 			if (c==STOP_CHAR(tty)) {
@@ -209,7 +328,7 @@ void copy_to_cooked(struct tty_struct * tty)
 		}
 		if (c==10 || c==EOF_CHAR(tty))
 			tty->secondary.data++;
-		if (L_ECHO(tty)) {
+		if (L_ECHO(tty) && echo_room(tty,2)) {
 			if (c==10) {
 				PUTCH(10,tty->write_q);
 				PUTCH(13,tty->write_q);
@@ -220,72 +339,145 @@ void copy_to_cooked(struct tty_struct * tty)
 				}
 			} else
 				PUTCH(c,tty->write_q);
-			tty->write(tty);
+			echo = 1;
 		}
 		PUTCH(c,tty->secondary);
 	}
-	wake_up(&tty->secondary.proc_list);
+	if (echo)
+		tty->write(tty);
+	wake_up_all(&tty->secondary.proc_list);
+}
+
+/* is there something for tty_read(): a whole line, in canonical mode */
+static int input_ready(struct tty_struct * tty)
+{
+	if (EMPTY(tty->secondary))
+		return 0;
+	return !L_CANON(tty) || tty->secondary.data ||
+		LEFT(tty->secondary)<=20;
 }
 
-int tty_read(unsigned channel, char * buf, int nr)
+/*
+ * wait_for_input() sleeps until there is input, or for at most 'ticks'
+ * if that isn't 0. It returns 0 if the time ran out.
+ */
+static int wait_for_input(struct tty_struct * tty, long ticks)
+{
+	int woken = 1;
+
+	cli();
+	if (ticks)
+		add_timer_data(ticks,process_timeout,(unsigned long) current);
+	if (!current->signal && !input_ready(tty) && !tty->hung_up)
+		interruptible_sleep_on(&tty->secondary.proc_list);
+	if (ticks)
+		woken = del_timer(process_timeout,(unsigned long) current);
+	sti();
+	return woken;
+}
+
+/*
+ * In canonical mode tty_read() returns a line. Otherwise it follows
+ * VMIN and VTIME (in tenths of a second):
+ *	MIN>0, TIME=0	wait for MIN characters
+ *	MIN>0, TIME>0	the same, but give up TIME after the last one came
+ *	MIN=0, TIME>0	wait at most TIME for one character
+ *	MIN=0, TIME=0	take what is there
+ * With O_NONBLOCK it never waits, and says -EAGAIN if there was nothing.
+ * Once a pty has been hung up, what is left is read and then it is EOF.
+ */
+int tty_read(unsigned channel, char * buf, int nr, int flags)
 {
 	struct tty_struct * tty;
 	char c, * b=buf;
-	int minimum,time,flag=0;
-	long oldalarm;
+	int minimum=0,time=0,again=0;
+	long expires=0,ticks;
 
-	if (channel>2 || nr<0) return -1;
+	if (channel>=NR_TTYS || nr<0) return -1;
 	tty = &tty_table[channel];
-	oldalarm = current->alarm;
-	time = 10L*tty->termios.c_cc[VTIME];
-	minimum = tty->termios.c_cc[VMIN];
-	if (time && !minimum) {
-		minimum=1;
-		if ((flag=(!oldalarm || time+jiffies<oldalarm)))
-			current->alarm = time+jiffies;
+	if (!L_CANON(tty)) {
+		time = (HZ/10)*tty->termios.c_cc[VTIME];
+		minimum = tty->termios.c_cc[VMIN];
+		if (time && !minimum)
+			expires = jiffies+time;
 	}
 	if (minimum>nr)
 		minimum=nr;
 	while (nr>0) {
-		if (flag && (current->signal & ALRMMASK)) {
-			current->signal &= ~ALRMMASK;
-			break;
-		}
 		if (current->signal)
 			break;
-		if (EMPTY(tty->secondary) || (L_CANON(tty) &&
-		!tty->secondary.data && LEFT(tty->secondary)>20)) {
-			sleep_if_empty(&tty->secondary);
+		if (!input_ready(tty)) {
+			if (tty->hung_up)
+				break;
+			if (flags & O_NONBLOCK) {
+				again = 1;
+				break;
+			}
+			if (!L_CANON(tty) && !minimum && !time)
+				break;
+			ticks = 0;
+			if (expires && (ticks = expires-jiffies) <= 0)
+				break;
+			if (!wait_for_input(tty,ticks))
+				break;
 			continue;
 		}
 		do {
 			GETCH(tty->secondary,c);
 			if (c==EOF_CHAR(tty) || c==10)
 				tty->secondary.data--;
-			if (c==EOF_CHAR(tty) && L_CANON(tty))
+			if (c==EOF_CHAR(tty) && L_CANON(tty)) {
+				if (IS_PTY(channel))
+					wake_up_all(&tty->read_q.proc_list);
 				return (b-buf);
-			else {
+			} else {
 				put_fs_byte(c,b++);
 				if (!--nr)
 					break;
 			}
 		} while (nr>0 && !EMPTY(tty->secondary));
-		if (time && !L_CANON(tty)) {
-			if ((flag=(!oldalarm || time+jiffies<oldalarm)))
-				current->alarm = time+jiffies;
-			else
-				current->alarm = oldalarm;
-		}
+		if (IS_PTY(channel))
+			wake_up_all(&tty->read_q.proc_list);	/* see pty.c */
 		if (L_CANON(tty)) {
 			if (b-buf)
 				break;
 		} else if (b-buf >= minimum)
 			break;
+		else if (time)
+			expires = jiffies+time;
 	}
-	current->alarm = oldalarm;
-	if (current->signal && !(b-buf))
+	if (b-buf)
+		return (b-buf);
+	if (current->signal)
 		return -EINTR;
-	return (b-buf);
+	return again ? -EAGAIN : 0;
+}
+
+/*
+ * tty_poll() is for select() and poll(): a tty is readable when there
+ * is something for tty_read(), and writable when tty_write() has room.
+ */
+int tty_poll(unsigned channel, int events, struct poll_table * pt)
+{
+	struct tty_struct * tty;
+	int mask = 0;
+
+	if (channel>=NR_TTYS)
+		return POLLERR;
+	tty = channel + tty_table;
+	if (events & POLLIN) {
+		poll_wait(&tty->secondary.proc_list,pt);
+		if (input_ready(tty))
+			mask |= POLLIN;
+	}
+	if (events & POLLOUT) {
+		poll_wait(&tty->write_q.proc_list,pt);
+		if (!FULL(tty->write_q))
+			mask |= POLLOUT;
+	}
+	if (tty->hung_up)
+		mask |= POLLHUP;
+	return mask;
 }
 
 int tty_write(unsigned channel, char * buf, int nr)
@@ -294,11 +486,11 @@ int tty_write(unsigned channel, char * buf, int nr)
 	struct tty_struct * tty;
 	char c, *b=buf;
 
-	if (channel>2 || nr<0) return -1;
+	if (channel>=NR_TTYS || nr<0) return -1;
 	tty = channel + tty_table;
 	while (nr>0) {
 		sleep_if_full(&tty->write_q);
-		if (current->signal)
+		if (current->signal || tty->hung_up)
 			break;
 		while (nr>0 && !FULL(tty->write_q)) {
 			c=get_fs_byte(b);
@@ -323,6 +515,8 @@ int tty_write(unsigned channel, char * buf, int nr)
 		if (nr>0)
 			schedule();
 	}
+	if (b==buf && tty->hung_up)
+		return -EIO;
 	return (b-buf);
 }
 
@@ -18,21 +18,53 @@
 static unsigned short quotient[] = {
 	0, 2304, 1536, 1047, 857,
 	768, 576, 384, 192, 96,
-	64, 48, 24, 12, 6, 3
+	64, 48, 24, 12, 6, 3,
+	2, 1				/* CBAUDEX: 57600, 115200 */
 };
 
-static void change_speed(struct tty_struct * tty)
+/* where the speed in 'cflag' is in quotient[], or -1 if it isn't */
+static int baud_index(unsigned long cflag)
 {
-	unsigned short port,quot;
+	int i = cflag & CBAUD;
+
+	if (!(i & CBAUDEX))
+		return i;
+	i &= ~CBAUDEX;
+	if (i < 1 || i > 2)
+		return -1;
+	return 15 + i;
+}
+
+/*
+ * change_speed() sets a serial line up as c_cflag says: speed, character
+ * size, stop bits and parity. B0 hangs up by dropping DTR and RTS. The
+ * speed has been checked with baud_index() already.
+ */
+void change_speed(struct tty_struct * tty)
+{
+	unsigned short port,quot,lcr;
+	unsigned long cflag = tty->termios.c_cflag;
+	int i;
 
-	if (!(port = tty->read_q.data))
+	if (!(port = tty->read_q.data) || (i = baud_index(cflag)) < 0)
 		return;
-	quot = quotient[tty->termios.c_cflag & CBAUD];
+	quot = quotient[i];
+	lcr = (cflag & CSIZE) >> 4;
+	if (cflag & CSTOPB)
+		lcr |= 0x04;
+	if (cflag & PARENB)
+		lcr |= (cflag & PARODD) ? 0x08 : 0x18;
 	cli();
+	if (!quot) {
+		outb(0x08,port+4);	/* OUT_2 only */
+		sti();
+		return;
+	}
+	outb_p(0x0b,port+4);		/* DTR, RTS, OUT_2 */
 	outb_p(0x80,port+3);		/* set DLAB */
 	outb_p(quot & 0xff,port);	/* LS of divisor */
 	outb_p(quot >> 8,port+1);	/* MS of divisor */
-	outb(0x03,port+3);		/* reset DLAB */
+	outb(lcr,port+3);		/* reset DLAB */
 	sti();
 }
 
@@ -65,11 +97,16 @@ static int get_termios(struct tty_struct * tty, struct termios * termios)
 
 static int set_termios(struct tty_struct * tty, struct termios * termios)
 {
+	struct termios tmp_termios;
 	int i;
 
 	for (i=0 ; i< (sizeof (*termios)) ; i++)
-		((char *)&tty->termios)[i]=get_fs_byte(i+(char *)termios);
+		((char *)&tmp_termios)[i]=get_fs_byte(i+(char *)termios);
+	if (baud_index(tmp_termios.c_cflag) < 0)
+		return -EINVAL;
+	tty->termios = tmp_termios;
 	change_speed(tty);
+	tty_set_special(tty);
 	return 0;
 }
 
@@ -101,6 +138,8 @@ static int set_termio(struct tty_struct * tty, struct termio * termio)
 
 	for (i=0 ; i< (sizeof (*termio)) ; i++)
 		((char *)&tmp_termio)[i]=get_fs_byte(i+(char *)termio);
+	if (baud_index(tmp_termio.c_cflag) < 0)
+		return -EINVAL;
 	*(unsigned short *)&tty->termios.c_iflag = tmp_termio.c_iflag;
 	*(unsigned short *)&tty->termios.c_oflag = tmp_termio.c_oflag;
 	*(unsigned short *)&tty->termios.c_cflag = tmp_termio.c_cflag;
@@ -109,6 +148,7 @@ static int set_termio(struct tty_struct * tty, struct termio * termio)
 	for(i=0 ; i < NCC ; i++)
 		tty->termios.c_cc[i] = tmp_termio.c_cc[i];
 	change_speed(tty);
+	tty_set_special(tty);
 	return 0;
 }
 
@@ -120,7 +160,9 @@ int tty_ioctl(int dev, int cmd, int arg)
 		if (dev<0)
 			panic("tty_ioctl: dev<0");
 	} else
-		dev=MINOR(dev);
+		dev=MINOR(dev) & ~PTY_MASTER;	/* a pty master sets its slave */
+	if (dev >= NR_TTYS)
+		return -ENODEV;
 	tty = dev + tty_table;
 	switch (cmd) {
 		case TCGETS:
@@ -180,6 +222,10 @@ int tty_ioctl(int dev, int cmd, int arg)
 			put_fs_long(CHARS(tty->secondary),
 				(unsigned long *) arg);
 			return 0;
+		case TIOCGOVERRUN:
+			verify_area((void *) arg,4);
+			put_fs_long(tty->read_q.overruns,(unsigned long *) arg);
+			return 0;
 		case TIOCSTI:
 			return -EINVAL; /* not implemented */
 		case TIOCGWINSZ:
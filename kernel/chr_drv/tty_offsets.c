@@ -0,0 +1,24 @@
+/*
+ *  linux/kernel/chr_drv/tty_offsets.c
+ */
+
+/*
+ * This isn't linked in. The Makefile compiles it to assembly and makes
+ * tty_offsets.inc out of the "->" lines, for rs_io.s and kb.S.
+ */
+#include <stddef.h>
+#include <linux/tty.h>
+
+#define OFFSET(sym,mem) \
+__asm__("\n->" #sym " %0" : : "i" (offsetof(struct tty_queue,mem)))
+
+void tty_offsets(void)
+{
+	OFFSET(rs_addr,data);
+	OFFSET(head,head);
+	OFFSET(tail,tail);
+	OFFSET(proc_list,proc_list);
+	OFFSET(mask,mask);
+	OFFSET(buf,buf);
+	OFFSET(overruns,overruns);
+}
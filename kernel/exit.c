@@ -29,6 +29,7 @@ void release(struct task_struct * p)
 			// 清空槽 （任务描述表中的对应表项）
 			task[i]=NULL;
 			// 释放页 （代码段，内存段，堆栈）
+			free_page(p->tss.cr3);
 			free_page((long)p);
 			// 重新进行调度
 			schedule();
@@ -123,7 +124,7 @@ int do_exit(long code)
 {
 	int i;
 	// 释放代码段占用的内存
-	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));
+	free_page_tables(current);
 	// 释放数据段占用的内存
 	// 销毁文件 子进程不能销毁 会让1号进程作为新的父进程
 	// 当前进程是一个会话头进程，会终止会话中的所有进程
@@ -133,7 +134,6 @@ int do_exit(long code)
 	   // 当父进程搜到SIGCHILD会终止僵死的子进程
 	// 首先父进程会把子进程的运行时间累加到自己的进程变量中
 	// 把对应的子进程的描述结构体进行释放，置空任务数组中的空槽
-	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));
 	for (i=0 ; i<NR_TASKS ; i++)
 		if (task[i] && task[i]->father == current->pid) {
 			task[i]->father = 1;
@@ -19,6 +19,7 @@
 #include <asm/system.h>
 
 extern void write_verify(unsigned long address);
+extern void ret_from_fork(void);
 
 long last_pid=0;
 
@@ -39,8 +40,8 @@ void verify_area(void * addr,int size)
 
 int copy_mem(int nr,struct task_struct * p)
 {
-	unsigned long old_data_base,new_data_base,data_limit;
-	unsigned long old_code_base,new_code_base,code_limit;
+	unsigned long old_data_base,data_limit;
+	unsigned long old_code_base,code_limit;
 
 	code_limit=get_limit(0x0f);
 	data_limit=get_limit(0x17);
@@ -50,13 +51,15 @@ int copy_mem(int nr,struct task_struct * p)
 		panic("We don't support separate I&D");
 	if (data_limit < code_limit)
 		panic("Bad data_limit");
-	new_data_base = new_code_base = nr * 0x4000000;
-	p->start_code = new_code_base;
-	set_base(p->ldt[1],new_code_base);
-	set_base(p->ldt[2],new_data_base);
-	if (copy_page_tables(old_data_base,new_data_base,data_limit)) {
+	p->start_code = TASK_BASE;
+	set_base(p->ldt[1],TASK_BASE);
+	set_base(p->ldt[2],TASK_BASE);
+	if (!(p->tss.cr3 = get_free_page()))
+		return -ENOMEM;
+	if (copy_page_tables(p)) {
 		printk("free_page_tables: from copy_mem\n");
-		free_page_tables(new_data_base,data_limit);
+		free_page_tables(p);
+		free_page(p->tss.cr3);
 		return -ENOMEM;
 	}
 	return 0;
@@ -66,6 +69,10 @@ int copy_mem(int nr,struct task_struct * p)
  *  Ok, this is the main fork-routine. It copies the system process
  * information (task[nr]) and sets up the necessary registers. It
  * also copies the data segment in it's entirety.
+ *
+ * The child gets a kernel stack that looks like the parent's on return
+ * from the system call (with %eax=0), plus the registers ret_from_fork
+ * pops: the first switch_to() to it ends up there.
  */
 int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 		long ebx,long ecx,long edx,
@@ -75,10 +82,15 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	struct task_struct *p;
 	int i;
 	struct file *f;
+	long * stack;
 	// 创建task_struct的结构通
 	p = (struct task_struct *) get_free_page();
 	if (!p)
 		return -EAGAIN;
+	if (task[nr]) {		/* get_free_page() may sleep in swap_out() */
+		free_page((long) p);
+		return -EAGAIN;
+	}
 	// 将当前的子进程放入的整体进程的链表中
 	task[nr] = p;
 	// 设置task_struct 结构体
@@ -95,27 +107,30 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	p->utime = p->stime = 0;
 	p->cutime = p->cstime = 0;
 	p->start_time = jiffies;
-	p->tss.back_link = 0;
-	p->tss.esp0 = PAGE_SIZE + (long) p;
-	p->tss.ss0 = 0x10;
-	p->tss.eip = eip;
-	p->tss.eflags = eflags;
-	p->tss.eax = 0;
-	p->tss.ecx = ecx;
-	p->tss.edx = edx;
-	p->tss.ebx = ebx;
-	p->tss.esp = esp;
-	p->tss.ebp = ebp;
-	p->tss.esi = esi;
-	p->tss.edi = edi;
-	p->tss.es = es & 0xffff;
-	p->tss.cs = cs & 0xffff;
-	p->tss.ss = ss & 0xffff;
-	p->tss.ds = ds & 0xffff;
-	p->tss.fs = fs & 0xffff;
-	p->tss.gs = gs & 0xffff;
+	p->on_rq = 0;
+	p->need_resched = 0;
+	p->has_cpu = 0;
+	p->lock_depth = 1;	/* ret_from_fork lets go of the kernel lock */
+	stack = (long *) (PAGE_SIZE + (long) p);
+	*--stack = ss & 0xffff;
+	*--stack = esp;
+	*--stack = eflags;
+	*--stack = cs & 0xffff;
+	*--stack = eip;
+	*--stack = ds & 0xffff;
+	*--stack = es & 0xffff;
+	*--stack = fs & 0xffff;
+	*--stack = edx;
+	*--stack = ecx;
+	*--stack = ebx;
+	*--stack = 0;		/* %eax: the child returns 0 */
+	*--stack = gs & 0xffff;
+	*--stack = esi;
+	*--stack = edi;
+	*--stack = ebp;
+	p->tss.esp = (long) stack;
+	p->tss.eip = (long) ret_from_fork;
 	p->tss.ldt = _LDT(nr);
-	p->tss.trace_bitmap = 0x80000000;
 	if (last_task_used_math == current)
 		__asm__("clts ; fnsave %0"::"m" (p->tss.i387));
 	if (copy_mem(nr,p)) {
@@ -135,7 +150,6 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 		current->root->i_count++;
 	if (current->executable)
 		current->executable->i_count++;
-	set_tss_desc(gdt+(nr<<1)+FIRST_TSS_ENTRY,&(p->tss));
 	set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY,&(p->ldt));
 	// 程序转态设置为可运行
 	p->state = TASK_RUNNING;	/* do this last, just in case */
@@ -18,9 +18,10 @@ void sys_sync(void);	/* it's really int */
 void panic(const char * s)
 {
 	printk("Kernel panic: %s\n\r",s);
-	if (current == task[0])
+	if (is_idle_task(current))
 		printk("In swapper task - not syncing\n\r");
-	else
+	console_drain();
+	if (!is_idle_task(current))
 		sys_sync();
 	for(;;);
 }
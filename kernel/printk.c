@@ -5,37 +5,175 @@
  */
 
 /*
- * When in kernel-mode, we cannot use printf, as fs is liable to
- * point to 'interesting' things. Make a printf with fs-saving, and
- * all is well.
+ * printk() only puts the message in log_buf. The console gets it from
+ * console_drain(), which the timer calls every tick, so a printk costs
+ * the formatting and no more, whatever context it is called from. What
+ * is in the log can be read with syslog().
+ *
+ * log_end is only ever written by printk(), with interrupts off, and
+ * the readers only move their own start: one that has fallen more than
+ * LOG_BUF_LEN behind has lost the oldest part, and skips it.
  */
 #include <stdarg.h>
 #include <stddef.h>
+#include <errno.h>
 
+#include <linux/sched.h>
 #include <linux/kernel.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define LOG_BUF_LEN	16384		/* a power of two */
+#define LOG_BUF(i)	log_buf[(i) & (LOG_BUF_LEN-1)]
 
 static char buf[1024];
+static char log_buf[LOG_BUF_LEN];
+
+static volatile unsigned long log_end = 0;	/* what printk() has put in */
+static unsigned long log_start = 0;	/* where syslog() reads next */
+static unsigned long log_clear = 0;	/* where the log was cleared */
+static unsigned long con_start = 0;	/* what the console has had */
+static unsigned long log_woken = 0;	/* log_end when readers were woken */
+static int console_off = 0;
+static struct wait_queue * log_wait = NULL;
 
 extern int vsprintf(char * buf, const char * fmt, va_list args);
 
 int printk(const char *fmt, ...)
 {
 	va_list args;
-	int i;
+	unsigned long flags, end;
+	int i, j;
 
+	save_flags(flags);
+	cli();
 	va_start(args, fmt);
 	i=vsprintf(buf,fmt,args);
 	va_end(args);
-	__asm__("push %%fs\n\t"
-		"push %%ds\n\t"
-		"pop %%fs\n\t"
-		"pushl %0\n\t"
-		"pushl $buf\n\t"
-		"pushl $0\n\t"
-		"call tty_write\n\t"
-		"addl $8,%%esp\n\t"
-		"popl %0\n\t"
-		"pop %%fs"
-		::"r" (i):"ax","cx","dx");
+	end = log_end;
+	for (j=0 ; j<i ; j++)
+		LOG_BUF(end+j) = buf[j];
+	log_end = end + i;
+	restore_flags(flags);
+	/* until the timer runs, nobody else will */
+	if (!jiffies)
+		console_drain();
 	return i;
 }
+
+/* the oldest of the log there still is, from 'start' on */
+static inline unsigned long log_from(unsigned long start, unsigned long end)
+{
+	if (end - start > LOG_BUF_LEN)
+		return end - LOG_BUF_LEN;
+	return start;
+}
+
+/*
+ * console_drain() hands the console what printk() has put in the log
+ * since last time, and wakes up anybody waiting in syslog(). panic()
+ * calls it too, as the timer may never get to it. If the timer came in
+ * the middle of con_write(), what is left stays in the log until the
+ * next tick.
+ */
+void console_drain(void)
+{
+	unsigned long end = log_end, n;
+
+	if (end == con_start && end == log_woken)
+		return;
+	con_start = log_from(con_start,end);
+	while (con_start != end) {
+		n = LOG_BUF_LEN - (con_start & (LOG_BUF_LEN-1));
+		if (n > end - con_start)
+			n = end - con_start;
+		if (!console_off && console_print(&LOG_BUF(con_start),n) < 0)
+			break;
+		con_start += n;
+	}
+	if (end != log_woken) {
+		log_woken = end;
+		wake_up_all(&log_wait);
+	}
+}
+
+static int log_copy(char * b, unsigned long start, unsigned long end)
+{
+	char * p = b;
+
+	while (start != end)
+		put_fs_byte(LOG_BUF(start++),p++);
+	return p-b;
+}
+
+/*
+ * sys_syslog() is for klogd and dmesg:
+ *
+ *	0, 1	close and open the log: nothing to do
+ *	2	read what is new, waiting for something if need be
+ *	3	read the last 'len' bytes of the log, leaving them
+ *	4	the same, and clear the log
+ *	5	clear the log
+ *	6, 7	turn printing kernel messages on the console off and on
+ *
+ * Only 3 is allowed to everybody.
+ */
+int sys_syslog(int type, char * buf, int len)
+{
+	unsigned long start, end;
+	int i;
+
+	if (type != 3 && !suser())
+		return -EPERM;
+	switch (type) {
+		case 0:
+		case 1:
+			return 0;
+		case 2:
+			if (!buf || len < 0)
+				return -EINVAL;
+			if (!len)
+				return 0;
+			verify_area(buf,len);
+			cli();
+			while (log_start == log_end) {
+				if (current->signal) {
+					sti();
+					return -EINTR;
+				}
+				interruptible_sleep_on(&log_wait);
+			}
+			sti();
+			end = log_end;
+			start = log_from(log_start,end);
+			if (end - start > len)
+				end = start + len;
+			log_start = end;
+			return log_copy(buf,start,end);
+		case 3:
+		case 4:
+			if (!buf || len < 0)
+				return -EINVAL;
+			if (!len)
+				return 0;
+			verify_area(buf,len);
+			end = log_end;
+			start = log_from(log_clear,end);
+			if (end - start > len)
+				start = end - len;
+			i = log_copy(buf,start,end);
+			if (type == 4)
+				log_clear = end;
+			return i;
+		case 5:
+			log_clear = log_end;
+			return 0;
+		case 6:
+			console_off = 1;
+			return 0;
+		case 7:
+			console_off = 0;
+			return 0;
+	}
+	return -EINVAL;
+}
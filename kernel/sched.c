@@ -14,10 +14,16 @@
 #include <linux/kernel.h>
 #include <linux/sys.h>
 #include <linux/fdreg.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/trace.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/segment.h>
+#include <asm/spinlock.h>
 
+#include <errno.h>
+#include <sched.h>
 #include <signal.h>
 
 #define _S(nr) (1<<((nr)-1))
@@ -42,6 +48,7 @@ void show_stat(void)
 	for (i=0;i<NR_TASKS;i++)
 		if (task[i])
 			show_task(i,task[i]);
+	kmem_cache_stats();
 }
 
 #define LATCH (1193180/HZ)
@@ -50,27 +57,38 @@ extern void mem_use(void);
 
 extern int timer_interrupt(void);
 extern int system_call(void);
+extern int sysenter_entry(void);
 
 union task_union {
 	struct task_struct task;
 	char stack[PAGE_SIZE];
 };
 
-static union task_union init_task = {INIT_TASK,};
+static union task_union init_task __attribute__((aligned(PAGE_SIZE))) =
+	{INIT_TASK,};
 
 long volatile jiffies=0;
 long startup_time=0;
-struct task_struct *current = &(init_task.task);
-struct task_struct *last_task_used_math = NULL;
+unsigned long * prof_buffer = NULL;
+unsigned long prof_len = 0;
+struct task_struct *cpu_last_math[NR_CPUS] = {NULL, };
 
 struct task_struct * task[NR_TASKS] = {&(init_task.task), };
 
+/* what each cpu runs, and what it runs when there is nothing else */
+struct task_struct * cpu_curr[NR_CPUS] = {&(init_task.task), };
+struct task_struct * idle_task[NR_CPUS] = {&(init_task.task), };
+
+struct tss_struct cpu_tss[NR_CPUS];
+
+/* task 0 in user mode, see move_to_user_mode() */
 long user_stack [ PAGE_SIZE>>2 ] ;
 
+/* the boot stack is the kernel stack of task 0 */
 struct {
 	long * a;
 	short b;
-	} stack_start = { & user_stack [PAGE_SIZE>>2] , 0x10 };
+	} stack_start = { (long *) (init_task.stack + PAGE_SIZE) , 0x10 };
 /*
  *  'math_state_restore()' saves the current math information in the
  * old math state array, and gets the new ones from the current task
@@ -103,26 +121,41 @@ void math_state_restore()
  * tasks can run. It can not be killed, and it cannot sleep. The 'state'
  * information in task[0] is never used.
  */
-void schedule(void)
+/*
+ * rt_pick_next() returns the real-time task to run, or 0 if there is no
+ * runnable one. The search starts after the current task, so that
+ * round-robin tasks of the same priority take turns, but a running FIFO
+ * task keeps the cpu against its equals. Tasks running on other cpus
+ * are left alone, here and below.
+ */
+static int rt_pick_next(void)
 {
-	int i,next,c;
-
-	struct task_struct ** p;
-
-/* check alarm, wake up any interruptible tasks that have got a signal */
-    // 
-	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
-		if (*p) {
-			if ((*p)->alarm && (*p)->alarm < jiffies) {
-					(*p)->signal |= (1<<(SIGALRM-1));
-					(*p)->alarm = 0;
-				}
-			if (((*p)->signal & ~(_BLOCKABLE & (*p)->blocked)) &&
-			(*p)->state==TASK_INTERRUPTIBLE)
-				(*p)->state=TASK_RUNNING;
-		}
+	struct task_struct * p;
+	int i, n, next = 0, prio = 0;
+
+	for (i = NR_TASKS-1 ; i && task[i] != current ; i--)
+		/* nothing */;
+	for (n = 1 ; n < NR_TASKS ; n++) {
+		if (++i >= NR_TASKS)
+			i = 1;
+		if (!(p = task[i]) || p->state != TASK_RUNNING ||
+		    p->policy == SCHED_OTHER || (p->has_cpu && p != current))
+			continue;
+		if (p->rt_priority > prio ||
+		    (p == current && p->policy == SCHED_FIFO &&
+		     p->rt_priority == prio))
+			prio = p->rt_priority, next = i;
+	}
+	if (next && !task[next]->counter)
+		task[next]->counter = task[next]->priority;
+	return next;
+}
 
 /* this is the scheduler proper: */
+static int counter_pick_next(void)
+{
+	int i,next,c;
+	struct task_struct ** p;
 
 	while (1) {
 		c = -1;
@@ -133,7 +166,8 @@ void schedule(void)
 			if (!*--p) 
 			   // 进程为空结束循环
 				continue;
-			if ((*p)->state == TASK_RUNNING && (*p)->counter > c)
+			if ((*p)->state == TASK_RUNNING && (*p)->counter > c &&
+			    (!(*p)->has_cpu || *p == current))
 				// 状态为可调度 并且counter大于上一个
 				c = (*p)->counter, next = i;
 		}
@@ -146,67 +180,251 @@ void schedule(void)
 				(*p)->counter = ((*p)->counter >> 1) +
 						(*p)->priority;
 	}
+	return next;
+}
+
+/*
+ * Task 0 is the idle task of the boot cpu. The other cpus have theirs
+ * in idle_task[], outside of the task table.
+ */
+void schedule(void)
+{
+	int next;
+	struct task_struct ** p, * n;
+
+	current->need_resched = 0;
+/* check alarm, wake up any interruptible tasks that have got a signal */
+    // 
+	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p) {
+			if ((*p)->alarm && (*p)->alarm < jiffies) {
+					(*p)->signal |= (1<<(SIGALRM-1));
+					(*p)->alarm = 0;
+				}
+			if (((*p)->signal & ~(_BLOCKABLE & (*p)->blocked)) &&
+			(*p)->state==TASK_INTERRUPTIBLE)
+				(*p)->state=TASK_RUNNING;
+		}
+
+	if (!(next = rt_pick_next()))
+		next = sched_fair ? fair_pick_next() : counter_pick_next();
+	n = next ? task[next] : idle_task[smp_processor_id()];
+	if (n != current)
+		tracepoint(TR_SWITCH,n->pid,current->state);
 	// 进行进程的切换
-	switch_to(next);
+	switch_to(n);
 }
 
 int sys_pause(void)
 {
 	current->state = TASK_INTERRUPTIBLE;
 	schedule();
+	if (is_idle_task(current))
+		cpu_idle();
 	return 0;
 }
 
-// 当某个进程想要访问cpu的资源的,cpu 资源被占用
-// 就会调用此函数把当前进程休眠
-void sleep_on(struct task_struct **p)
+/*
+ * The entry of a sleeper lives on its own kernel stack, and it takes it
+ * off the queue again itself. Exclusive sleepers go at the end, so they
+ * are woken in order. Interrupts are off while the queue is changed:
+ * wake-ups come from interrupts too. waitqueue_lock keeps out the other
+ * cpus.
+ */
+static spinlock_t waitqueue_lock = SPIN_LOCK_UNLOCKED;
+
+static void add_wait_queue(struct wait_queue ** p, struct wait_queue * wait)
+{
+	if (!wait->exclusive || !*p) {
+		wait->next = *p;
+		*p = wait;
+		return;
+	}
+	while ((*p)->next)
+		p = &(*p)->next;
+	wait->next = NULL;
+	(*p)->next = wait;
+}
+
+static void remove_wait_queue(struct wait_queue ** p, struct wait_queue * wait)
 {
-	struct task_struct *tmp;
+	for ( ; *p ; p = &(*p)->next)
+		if (*p == wait) {
+			*p = wait->next;
+			return;
+		}
+	printk("remove_wait_queue: not on queue\n\r");
+}
+
+/*
+ * A caller that holds 'lock' (with interrupts off) while it looks at
+ * what it waits for passes it in: it is let go only once the task is on
+ * the queue, so a wake-up from whoever takes it next can't be lost, and
+ * it is taken again before __sleep_on() returns. Take it before
+ * waitqueue_lock, never after.
+ */
+static void __sleep_on(struct wait_queue ** p, int state, int exclusive,
+	spinlock_t * lock)
+{
+	struct wait_queue wait;
+	unsigned long flags;
 
 	if (!p)
 		return;
-	// 当前进程是0号进程，不能休眠
-	if (current == &(init_task.task))
-		panic("task[0] trying to sleep"); 
-	// 进程指针p赋值给一个临时变量
-	tmp = *p;
-	// 当前等待进程设置到p
-	*p = current;
-	// 当前指针设置为不可中断状态
-	current->state = TASK_UNINTERRUPTIBLE;
-	// 进行调度
+	if (is_idle_task(current))
+		panic("task[0] trying to sleep");
+	wait.task = current;
+	wait.exclusive = exclusive;
+	spin_lock_irqsave(&waitqueue_lock,flags);
+	add_wait_queue(p,&wait);
+	current->state = state;
+	spin_unlock(&waitqueue_lock);
+	if (lock)
+		spin_unlock(lock);
 	schedule();
-	if (tmp)
-		tmp->state=0;
+	spin_lock(&waitqueue_lock);
+	remove_wait_queue(p,&wait);
+	spin_unlock(&waitqueue_lock);
+	if (lock)
+		spin_lock(lock);
+	restore_flags(flags);
 }
 
-void interruptible_sleep_on(struct task_struct **p)
+void sleep_on(struct wait_queue ** p)
 {
-	struct task_struct *tmp;
+	__sleep_on(p,TASK_UNINTERRUPTIBLE,0,NULL);
+}
+
+void sleep_on_exclusive(struct wait_queue ** p)
+{
+	__sleep_on(p,TASK_UNINTERRUPTIBLE,1,NULL);
+}
+
+void interruptible_sleep_on(struct wait_queue ** p)
+{
+	__sleep_on(p,TASK_INTERRUPTIBLE,0,NULL);
+}
+
+void sleep_on_unlock(struct wait_queue ** p, spinlock_t * lock)
+{
+	__sleep_on(p,TASK_UNINTERRUPTIBLE,0,lock);
+}
+
+void sleep_on_exclusive_unlock(struct wait_queue ** p, spinlock_t * lock)
+{
+	__sleep_on(p,TASK_UNINTERRUPTIBLE,1,lock);
+}
+
+/*
+ * poll_wait() puts the current task on one more queue, with an entry
+ * from the poll table. Unlike sleep_on(), it doesn't sleep: the caller
+ * does that once it is on all the queues it wants. A null table means
+ * it has been round once already.
+ */
+void poll_wait(struct wait_queue ** p, struct poll_table * pt)
+{
+	struct poll_table_entry * entry;
+	unsigned long flags;
+
+	if (!p || !pt || pt->nr >= POLL_TABLE_ENTRIES)
+		return;
+	entry = pt->entry + pt->nr++;
+	entry->wait.task = current;
+	entry->wait.exclusive = 0;
+	entry->wait_address = p;
+	spin_lock_irqsave(&waitqueue_lock,flags);
+	add_wait_queue(p,&entry->wait);
+	spin_unlock_irqrestore(&waitqueue_lock,flags);
+}
+
+void poll_freewait(struct poll_table * pt)
+{
+	struct poll_table_entry * entry = pt->entry + pt->nr;
+	unsigned long flags;
+
+	spin_lock_irqsave(&waitqueue_lock,flags);
+	while (entry-- > pt->entry)
+		remove_wait_queue(entry->wait_address,&entry->wait);
+	spin_unlock_irqrestore(&waitqueue_lock,flags);
+	pt->nr = 0;
+}
+
+/*
+ * intr_resched() is called by device interrupts on their way out, with
+ * the code segment they interrupted. The kernel isn't preemptible, so
+ * the switch only happens if that was user mode.
+ */
+void intr_resched(long cs)
+{
+	if (current->need_resched && (cs & 3))
+		schedule();
+}
+
+/*
+ * wakeup_preempt() says if 'p', just woken up, should run before the
+ * current task. Real-time tasks go by priority and beat all others, the
+ * rest go by what their scheduling class would pick.
+ */
+static int wakeup_preempt(struct task_struct * p)
+{
+	if (is_idle_task(current))
+		return 1;
+	if (p->policy != SCHED_OTHER)
+		return current->policy == SCHED_OTHER ||
+			p->rt_priority > current->rt_priority;
+	if (current->policy != SCHED_OTHER)
+		return 0;
+	if (sched_fair)
+		return fair_wakeup_preempt(p);
+	return p->counter > current->counter;
+}
+
+/*
+ * If the woken task should run first, need_resched makes the way back
+ * to user mode - from a system call or an interrupt - call schedule().
+ * If not, an idle cpu is told to have a look.
+ */
+static inline int wake_task(struct task_struct * p)
+{
+	if (p->state != TASK_INTERRUPTIBLE && p->state != TASK_UNINTERRUPTIBLE)
+		return 0;
+	p->state = TASK_RUNNING;
+	if (wakeup_preempt(p))
+		current->need_resched = 1;
+	else
+		smp_wake_idle();
+	return 1;
+}
+
+/*
+ * wake_up_one() wakes all ordinary sleepers, but only the first exclusive
+ * one that isn't already awake: that is what a freed resource is for.
+ */
+void wake_up_one(struct wait_queue ** p)
+{
+	struct wait_queue * tmp;
+	unsigned long flags;
 
 	if (!p)
 		return;
-	if (current == &(init_task.task))
-		panic("task[0] trying to sleep");
-	tmp=*p;
-	*p=current;
-repeat:	current->state = TASK_INTERRUPTIBLE;
-	schedule();
-	if (*p && *p != current) {
-		(**p).state=0;
-		goto repeat;
-	}
-	*p=NULL;
-	if (tmp)
-		tmp->state=0;
+	spin_lock_irqsave(&waitqueue_lock,flags);
+	for (tmp = *p ; tmp ; tmp = tmp->next)
+		if (wake_task(tmp->task) && tmp->exclusive)
+			break;
+	spin_unlock_irqrestore(&waitqueue_lock,flags);
 }
 
-void wake_up(struct task_struct **p)
+void wake_up_all(struct wait_queue ** p)
 {
-	if (p && *p) {
-		(**p).state=0;
-		*p=NULL;
-	}
+	struct wait_queue * tmp;
+	unsigned long flags;
+
+	if (!p)
+		return;
+	spin_lock_irqsave(&waitqueue_lock,flags);
+	for (tmp = *p ; tmp ; tmp = tmp->next)
+		wake_task(tmp->task);
+	spin_unlock_irqrestore(&waitqueue_lock,flags);
 }
 
 /*
@@ -214,7 +432,7 @@ void wake_up(struct task_struct **p)
  * proper. They are here because the floppy needs a timer, and this
  * was the easiest way of doing it.
  */
-static struct task_struct * wait_motor[4] = {NULL,NULL,NULL,NULL};
+static struct wait_queue * wait_motor[4] = {NULL,NULL,NULL,NULL};
 static int  mon_timer[4]={0,0,0,0};
 static int moff_timer[4]={0,0,0,0};
 unsigned char current_DOR = 0x0C;
@@ -268,7 +486,7 @@ void do_floppy_timer(void)
 			continue;
 		if (mon_timer[i]) {
 			if (!--mon_timer[i])
-				wake_up(i+wait_motor);
+				wake_up_all(i+wait_motor);
 		} else if (!moff_timer[i]) {
 			current_DOR &= ~mask;
 			outb(current_DOR,FD_DOR);
@@ -277,76 +495,204 @@ void do_floppy_timer(void)
 	}
 }
 
-#define TIME_REQUESTS 64
-
+/*
+ * Timer requests come from a slab cache, so there is no fixed limit on
+ * them. add_timer() may be called from interrupts: the allocation is
+ * atomic. The list is kept in order, each entry holding the ticks from
+ * the one before it, and 'data' is handed to the function when it runs.
+ * timer_lock is only held while the list changes, not while a function
+ * runs: that may add another request.
+ */
 static struct timer_list {
 	long jiffies;
-	void (*fn)();
+	void (*fn)(unsigned long);
+	unsigned long data;
 	struct timer_list * next;
-} timer_list[TIME_REQUESTS], * next_timer = NULL;
+} * next_timer = NULL;
 
-void add_timer(long jiffies, void (*fn)(void))
+static struct kmem_cache * timer_cachep;
+static spinlock_t timer_lock = SPIN_LOCK_UNLOCKED;
+
+void add_timer_data(long jiffies, void (*fn)(unsigned long), unsigned long data)
 {
-	struct timer_list * p;
+	struct timer_list * p, ** pp;
+	unsigned long flags;
 
 	if (!fn)
 		return;
+	save_flags(flags);
 	cli();
 	if (jiffies <= 0)
-		(fn)();
+		(fn)(data);
 	else {
-		for (p = timer_list ; p < timer_list + TIME_REQUESTS ; p++)
-			if (!p->fn)
-				break;
-		if (p >= timer_list + TIME_REQUESTS)
+		if (!(p = (struct timer_list *)
+		    kmem_cache_alloc(timer_cachep,GFP_ATOMIC)))
 			panic("No more time requests free");
 		p->fn = fn;
+		p->data = data;
+		spin_lock(&timer_lock);
+		for (pp = &next_timer ; *pp && (*pp)->jiffies < jiffies ;
+		     pp = &(*pp)->next)
+			jiffies -= (*pp)->jiffies;
 		p->jiffies = jiffies;
-		p->next = next_timer;
-		next_timer = p;
-		while (p->next && p->next->jiffies < p->jiffies) {
-			p->jiffies -= p->next->jiffies;
-			fn = p->fn;
-			p->fn = p->next->fn;
-			p->next->fn = fn;
-			jiffies = p->jiffies;
-			p->jiffies = p->next->jiffies;
-			p->next->jiffies = jiffies;
-			p = p->next;
+		if ((p->next = *pp))
+			p->next->jiffies -= jiffies;
+		*pp = p;
+		spin_unlock(&timer_lock);
+	}
+	restore_flags(flags);
+}
+
+void add_timer(long jiffies, void (*fn)(void))
+{
+	add_timer_data(jiffies,(void (*)(unsigned long)) fn,0);
+}
+
+/*
+ * del_timer() takes back a request that hasn't run yet, and returns 0
+ * if there was none. The time it had left goes to the one after it.
+ */
+int del_timer(void (*fn)(unsigned long), unsigned long data)
+{
+	struct timer_list * p, ** pp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&timer_lock,flags);
+	for (pp = &next_timer ; (p = *pp) ; pp = &p->next)
+		if (p->fn == fn && p->data == data) {
+			if ((*pp = p->next))
+				p->next->jiffies += p->jiffies;
+			spin_unlock_irqrestore(&timer_lock,flags);
+			kmem_cache_free(timer_cachep,p);
+			return 1;
 		}
+	spin_unlock_irqrestore(&timer_lock,flags);
+	return 0;
+}
+
+/*
+ * run_timers() moves the timer list on by 'ticks' and runs whatever has
+ * expired. The list holds differences, so any overshoot is carried over
+ * to the next entry. Interrupts are off.
+ */
+static void run_timers(long ticks)
+{
+	struct timer_list * p;
+	void (*fn)(unsigned long);
+	unsigned long data;
+
+	spin_lock(&timer_lock);
+	if (next_timer)
+		next_timer->jiffies -= ticks;
+	while ((p = next_timer) && p->jiffies <= 0) {
+		fn = p->fn;
+		data = p->data;
+		if ((next_timer = p->next))
+			next_timer->jiffies += p->jiffies;
+		spin_unlock(&timer_lock);
+		kmem_cache_free(timer_cachep,p);
+		(fn)(data);
+		spin_lock(&timer_lock);
 	}
-	sti();
+	spin_unlock(&timer_lock);
 }
 
-void do_timer(long cpl)
+/*
+ * When there is nothing to run, task 0 stops the tick: the timer is put
+ * in one-shot mode for as many ticks as there is nothing to do, and
+ * idle_ticks says how many. The PIT can only count 5 ticks that way.
+ */
+#define MAX_IDLE_TICKS (0xffff/LATCH)
+
+long idle_ticks = 0;
+
+/*
+ * Mode 2 rather than a square wave: the count then goes down by one per
+ * clock, so do_gettime() can read how far into a tick we are.
+ */
+static void start_hz(void)
+{
+	outb_p(0x34,0x43);		/* binary, mode 2, LSB/MSB, ch 0 */
+	outb_p(LATCH & 0xff , 0x40);	/* LSB */
+	outb(LATCH >> 8 , 0x40);	/* MSB */
+}
+
+static void one_shot(long ticks, long count)
+{
+	idle_ticks = ticks;
+	outb_p(0x30,0x43);		/* binary, mode 0, LSB/MSB, ch 0 */
+	outb_p(count & 0xff , 0x40);
+	outb(count >> 8 , 0x40);
+}
+
+void do_timer(long cpl, unsigned long eip)
 {
 	extern int beepcount;
 	extern void sysbeepstop(void);
 
+	if (idle_ticks) {
+		long ticks = idle_ticks - 1;
+
+		idle_ticks = 0;
+		start_hz();
+		jiffies += ticks;
+		run_timers(ticks);
+	}
 	if (beepcount)
 		if (!--beepcount)
 			sysbeepstop();
+	// 嫁接于jiffies的变量的素有定时器的事件链表
+	run_timers(1);
+	if (current_DOR & 0xf0)
+		do_floppy_timer();
+	console_drain();
+	update_process_times(cpl,eip);
+}
+
+/*
+ * profile_tick() counts the tick in the kernel profile, or in the task's
+ * own if it is in user mode and has asked for that with sys_prof(). The
+ * timer can't take a page fault, so a counter that isn't in a present,
+ * writable page misses the tick.
+ */
+static void profile_tick(long cpl, unsigned long eip)
+{
+	unsigned long off, * pte;
+
+	if (!cpl) {
+		if ((eip >>= PROFILE_SHIFT) < prof_len)
+			prof_buffer[eip]++;
+		return;
+	}
+	if (current->prof_scale < 2 || eip < current->prof_off)
+		return;
+	off = ((unsigned long long) (eip - current->prof_off) *
+		current->prof_scale >> 16) & ~1;
+	if (off >= current->prof_size)
+		return;
+	off += current->start_code + current->prof_buf;
+	if ((pte = get_pte(off)) && (*pte & 3) == 3)
+		++*(unsigned short *) off;
+}
 
+/*
+ * update_process_times() charges the tick to the task this cpu runs, and
+ * ends its slice when it is used up. The boot cpu gets here from
+ * do_timer(), the others from their local APIC timer.
+ */
+void update_process_times(long cpl, unsigned long eip)
+{
+	profile_tick(cpl,eip);
 	if (cpl) // 当前被中断进程是 0表示内核进程 1表示用户进程
 		// current 表示当前的进程
 		current->utime++; // 用户程序运行时间+1
 	else
 		current->stime++; // 内核程序运行时间+1
     
-	if (next_timer) { // 嫁接于jiffies的变量的素有定时器的事件链表
-		next_timer->jiffies--;
-		while (next_timer && next_timer->jiffies <= 0) {
-			// 触发对应的事件
-			void (*fn)(void);
-			
-			fn = next_timer->fn;
-			next_timer->fn = NULL;
-			next_timer = next_timer->next;
-			(fn)();
-		}
-	}
-	if (current_DOR & 0xf0)
-		do_floppy_timer();
+	if (sched_fair)
+		fair_tick();
+	if (current->policy == SCHED_FIFO && current->counter)
+		return;
 	// 进程的时间片 进程的剩余运行时间
 	if ((--current->counter)>0) return;
 	current->counter=0;
@@ -354,6 +700,79 @@ void do_timer(long cpl)
 	schedule();
 }
 
+/*
+ * idle_until() returns how many ticks nothing will happen for: no timer
+ * or alarm runs out. A beep or a floppy motor want every tick.
+ */
+static long idle_until(void)
+{
+	extern int beepcount;
+	struct task_struct ** p;
+	long ticks = MAX_IDLE_TICKS;
+
+	if (beepcount || (current_DOR & 0xf0))
+		return 1;
+	if (next_timer && next_timer->jiffies < ticks)
+		ticks = next_timer->jiffies;
+	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p && (*p)->alarm && (*p)->alarm - jiffies < ticks)
+			ticks = (*p)->alarm - jiffies + 1;
+	return ticks;
+}
+
+/*
+ * After some other interrupt has woken us, find out how many whole ticks
+ * have gone by, and finish the one we're in with another one-shot. If
+ * the timer has already run out, its interrupt does the accounting.
+ */
+static long restart_hz(void)
+{
+	long left, passed;
+
+	if (!idle_ticks)
+		return 0;
+	outb_p(0xc2,0x43);		/* read back status and count, ch 0 */
+	if (inb_p(0x40) & 0x80) {	/* OUT high: counted down */
+		inb_p(0x40);
+		inb_p(0x40);
+		return 0;
+	}
+	left = inb_p(0x40);
+	left |= inb_p(0x40) << 8;
+	passed = idle_ticks*LATCH - left;
+	one_shot(1,LATCH - passed % LATCH);
+	return passed / LATCH;
+}
+
+/*
+ * cpu_idle() is where an idle task waits for an interrupt when no other
+ * task can run. sti only takes effect after the hlt, so a wake-up can't
+ * slip in between. The kernel lock, held once by the idle task, is let
+ * go meanwhile. Only a lone cpu stops the tick: the others need jiffies.
+ */
+void cpu_idle(void)
+{
+	struct task_struct ** p;
+	long ticks;
+
+	cli();
+	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)
+		if (*p && (*p)->state == TASK_RUNNING && !(*p)->has_cpu) {
+			sti();
+			return;
+		}
+	if (smp_num_cpus == 1 && !idle_ticks && (ticks = idle_until()) > 1)
+		one_shot(ticks,ticks*LATCH);
+	unlock_kernel();
+	__asm__ __volatile__("sti ; hlt ; cli");
+	lock_kernel();
+	if ((ticks = restart_hz())) {
+		jiffies += ticks;
+		run_timers(ticks);
+	}
+	sti();
+}
+
 int sys_alarm(long seconds)
 {
 	int old = current->alarm;
@@ -401,6 +820,90 @@ int sys_nice(long increment)
 	return 0;
 }
 
+static struct task_struct * find_task_by_pid(int pid)
+{
+	int i;
+
+	if (!pid)
+		return current;
+	for (i = 1 ; i < NR_TASKS ; i++)
+		if (task[i] && task[i]->pid == pid)
+			return task[i];
+	return NULL;
+}
+
+/*
+ * Only the superuser may make a task real-time. Anybody may make their own
+ * tasks SCHED_OTHER again.
+ */
+int sys_sched_setscheduler(int pid, int policy, struct sched_param * param)
+{
+	struct task_struct * p;
+	int prio;
+
+	if (pid < 0 || !param)
+		return -EINVAL;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
+	prio = get_fs_long((unsigned long *) &param->sched_priority);
+	switch (policy) {
+		case SCHED_OTHER:
+			if (prio)
+				return -EINVAL;
+			break;
+		case SCHED_FIFO:
+		case SCHED_RR:
+			if (prio < SCHED_PRIO_MIN || prio > SCHED_PRIO_MAX)
+				return -EINVAL;
+			if (!suser())
+				return -EPERM;
+			break;
+		default:
+			return -EINVAL;
+	}
+	if (p != current && current->euid != p->euid &&
+	    current->euid != p->uid && !suser())
+		return -EPERM;
+	p->policy = policy;
+	p->rt_priority = prio;
+	current->need_resched = 1;
+	return 0;
+}
+
+int sys_sched_getscheduler(int pid)
+{
+	struct task_struct * p;
+
+	if (pid < 0)
+		return -EINVAL;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
+	return p->policy;
+}
+
+/*
+ * tss_init() sets up the TSS of a cpu, running its idle task, and its
+ * sysenter entry. sysenter_entry finds esp0 just below the stack it is
+ * given.
+ */
+void tss_init(int cpu)
+{
+	struct tss_struct * tss = cpu_tss + cpu;
+
+	// 进程的状态描述符
+	tss->esp0 = PAGE_SIZE + (long) idle_task[cpu];
+	tss->ss0 = 0x10;
+	tss->trace_bitmap = 0x80000000;	/* no io bitmap */
+	set_tss_desc(gdt+FIRST_TSS_ENTRY+2*cpu,tss);
+	ltr(cpu);
+	lldt(0);
+	if (cpu_features & CPU_SEP) {
+		wrmsr(MSR_SYSENTER_CS,0x08,0);
+		wrmsr(MSR_SYSENTER_ESP,(long) (&tss->esp0 + 1),0);
+		wrmsr(MSR_SYSENTER_EIP,(long) sysenter_entry,0);
+	}
+}
+
 void sched_init(void)
 {
 	int i;
@@ -408,8 +911,6 @@ void sched_init(void)
 
 	if (sizeof(struct sigaction) != 16)
 		panic("Struct sigaction MUST be 16 bytes");
-	// 进程的状态描述符
-	set_tss_desc(gdt+FIRST_TSS_ENTRY,&(init_task.task.tss));
 	// 局部描述符 数据段 代码段
 	set_ldt_desc(gdt+FIRST_LDT_ENTRY,&(init_task.task.ldt));
 	p = gdt+2+FIRST_TSS_ENTRY;
@@ -423,11 +924,10 @@ void sched_init(void)
 	}
 /* Clear NT, so that we won't have troubles with that later on */
 	__asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
-	ltr(0);
-	lldt(0);
-	outb_p(0x36,0x43);		/* binary, mode 3, LSB/MSB, ch 0 */
-	outb_p(LATCH & 0xff , 0x40);	/* LSB */
-	outb(LATCH >> 8 , 0x40);	/* MSB */
+	timer_cachep = kmem_cache_create("timer",
+		sizeof(struct timer_list),NULL);
+	tss_init(0);
+	start_hz();
 	set_intr_gate(0x20,&timer_interrupt);
 	outb(inb_p(0x21)&~0x01,0x21);
 	// 注册一个系统调用的中断 所有人可以调用
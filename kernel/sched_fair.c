@@ -0,0 +1,189 @@
+/*
+ *  linux/kernel/sched_fair.c
+ */
+
+/*
+ * The fair scheduling class. It is used instead of the counter algorithm
+ * in schedule() when the boot sector asks for it (see SCHED_CLASS in the
+ * top Makefile).
+ *
+ * Every task has a virtual runtime: the time it has had the cpu, scaled
+ * by the inverse of its weight, which comes from its nice value. The
+ * runnable tasks are kept in a red-black tree sorted on it. The one that
+ * is furthest behind runs next, for its share of SCHED_PERIOD. A task
+ * waking up is put at most half a period behind the others, so sleeping
+ * doesn't buy it the cpu for long.
+ *
+ * Task states are changed all over the place, so instead of hooking all
+ * of them, fair_pick_next() brings the tree up to date while it goes
+ * through the task table, as schedule() did anyway. The running task is
+ * kept out of the tree.
+ *
+ * Each cpu has a tree of its own, and a task goes back in that of the
+ * cpu it last ran on. A cpu with an empty tree, or one with more than one
+ * task less than the busiest, takes the leftmost task from that one. Its
+ * virtual runtime is moved over to the new tree's min_vruntime.
+ */
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/rbtree.h>
+
+#define NICE_0_LOAD	1024
+#define SCHED_PERIOD	6		/* ticks */
+#define USEC_PER_TICK	(1000000/HZ)
+#define SLEEPER_CREDIT	(SCHED_PERIOD*USEC_PER_TICK/2)
+#define WAKEUP_GRAN	USEC_PER_TICK
+
+#define vruntime_before(a,b) ((long) ((a) - (b)) < 0)
+
+int sched_fair = 0;
+
+static struct fair_rq {
+	struct rb_root tasks;
+	unsigned long min_vruntime;
+	int nr_running;
+} fair_rqs[NR_CPUS];
+
+/*
+ * Each nice level is worth about 10% of cpu time against the next one,
+ * so the weights go up by 1.25 a level. Nice 0 weighs NICE_0_LOAD.
+ */
+static const int prio_to_weight[40] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	 9548,  7620,  6100,  4904,  3906,
+	 3121,  2501,  1991,  1586,  1277,
+	 1024,   820,   655,   526,   423,
+	  335,   272,   215,   172,   137,
+	  110,    87,    70,    56,    45,
+	   36,    29,    23,    18,    15,
+};
+
+/* nice 0 is the default priority of 15, see INIT_TASK and sys_nice() */
+static int task_weight(struct task_struct * p)
+{
+	int nice = 15 - p->priority;
+
+	if (nice < -20)
+		nice = -20;
+	else if (nice > 19)
+		nice = 19;
+	return prio_to_weight[nice+20];
+}
+
+/* on_rq is the number of the cpu whose tree the task is in, plus one */
+static void enqueue_fair(struct task_struct * p, int cpu)
+{
+	struct fair_rq * rq = fair_rqs + cpu;
+	struct rb_node ** link = &rq->tasks.rb_node;
+	struct rb_node * parent = NULL;
+
+	while (*link) {
+		parent = *link;
+		if (vruntime_before(p->vruntime,
+		    rb_entry(parent,struct task_struct,run_node)->vruntime))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&p->run_node,parent,link);
+	rb_insert_color(&p->run_node,&rq->tasks);
+	rq->nr_running++;
+	p->on_rq = cpu + 1;
+}
+
+static void dequeue_fair(struct task_struct * p)
+{
+	struct fair_rq * rq = fair_rqs + p->on_rq - 1;
+
+	rb_erase(&p->run_node,&rq->tasks);
+	rq->nr_running--;
+	p->on_rq = 0;
+}
+
+/*
+ * fair_tick() charges the current task for one tick.
+ */
+void fair_tick(void)
+{
+	if (!is_idle_task(current))
+		current->vruntime += USEC_PER_TICK * NICE_0_LOAD /
+			task_weight(current);
+}
+
+/*
+ * A task that wakes up takes the cpu at once if it is more than a tick
+ * behind the current one, counting the sleeper credit it will get.
+ */
+int fair_wakeup_preempt(struct task_struct * p)
+{
+	unsigned long min_vruntime = fair_rqs[smp_processor_id()].min_vruntime;
+	unsigned long vruntime = p->vruntime;
+
+	if (vruntime_before(vruntime,min_vruntime - SLEEPER_CREDIT))
+		vruntime = min_vruntime - SLEEPER_CREDIT;
+	return vruntime_before(vruntime + WAKEUP_GRAN,current->vruntime);
+}
+
+/*
+ * fair_pick_next() returns the number of the task this cpu should run
+ * next, with its slice in 'counter'. It gets the idle task when nothing
+ * else can run.
+ */
+int fair_pick_next(void)
+{
+	struct task_struct * p;
+	struct fair_rq * rq, * busiest = NULL;
+	struct rb_node * node;
+	unsigned long load[NR_CPUS];
+	int i, slice, cpu = smp_processor_id();
+
+	for (i = 0 ; i < NR_CPUS ; i++)
+		load[i] = 0;
+	for (i = 1 ; i < NR_TASKS ; i++) {
+		if (!(p = task[i]))
+			continue;
+		if (p->state != TASK_RUNNING || (p->has_cpu && p != current)) {
+			if (p->on_rq)
+				dequeue_fair(p);
+			if (p->state == TASK_RUNNING)
+				load[p->processor] += task_weight(p);
+			continue;
+		}
+		if (!p->on_rq) {
+			rq = fair_rqs + p->processor;
+			if (p != current && vruntime_before(p->vruntime,
+			    rq->min_vruntime - SLEEPER_CREDIT))
+				p->vruntime = rq->min_vruntime - SLEEPER_CREDIT;
+			enqueue_fair(p,p->processor);
+		}
+		load[p->on_rq-1] += task_weight(p);
+	}
+	rq = fair_rqs + cpu;
+	for (i = 0 ; i < smp_num_cpus ; i++)
+		if (i != cpu && (!busiest ||
+		    fair_rqs[i].nr_running > busiest->nr_running))
+			busiest = fair_rqs + i;
+	if (busiest && busiest->nr_running >
+	    rq->nr_running + (rq->nr_running != 0)) {
+		p = rb_entry(rb_first(&busiest->tasks),struct task_struct,
+			run_node);
+		dequeue_fair(p);
+		load[busiest-fair_rqs] -= task_weight(p);
+		load[cpu] += task_weight(p);
+		p->vruntime += rq->min_vruntime - busiest->min_vruntime;
+		enqueue_fair(p,cpu);
+	}
+	if (!(node = rb_first(&rq->tasks)))
+		return 0;
+	p = rb_entry(node,struct task_struct,run_node);
+	dequeue_fair(p);
+	if (vruntime_before(rq->min_vruntime,p->vruntime))
+		rq->min_vruntime = p->vruntime;
+	slice = SCHED_PERIOD * task_weight(p) / load[cpu];
+	p->counter = slice ? slice : 1;
+	for (i = 1 ; task[i] != p ; i++)
+		/* nothing */;
+	return i;
+}
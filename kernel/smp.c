@@ -0,0 +1,467 @@
+/*
+ *  linux/kernel/smp.c
+ */
+
+/*
+ * smp.c brings up the other cpus, if the BIOS has an Intel MP table that
+ * tells about them, and has what the kernel needs to run on more than one
+ * at a time: the kernel lock, the interprocessor interrupts and the
+ * IO-APIC, which takes the device interrupts over from the 8259s.
+ *
+ * The cpus are numbered from 0, the boot cpu, in the order they come up.
+ * Each has its own idle task, its own TSS and a local APIC timer for its
+ * time slices. Device interrupts all go to the boot cpu, and jiffies and
+ * the timer list are still kept there.
+ */
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/head.h>
+#include <linux/mm.h>
+#include <asm/system.h>
+#include <asm/io.h>
+#include <asm/spinlock.h>
+
+#define APIC_ID		0x20
+#define APIC_TPR	0x80
+#define APIC_SVR	0xf0
+#define APIC_ICR	0x300
+#define APIC_ICR2	0x310
+#define APIC_LVTT	0x320
+#define APIC_LINT0	0x350
+#define APIC_TMICT	0x380
+#define APIC_TMCCT	0x390
+#define APIC_TDCR	0x3e0
+
+#define apic_read(reg) (*(volatile unsigned long *) (apic_base+(reg)))
+#define apic_write(reg,val) (*(volatile unsigned long *) (apic_base+(reg)) = (val))
+
+#define LOCAL_TIMER_VECTOR	0x41
+#define RESCHEDULE_VECTOR	0x42
+#define INVALIDATE_VECTOR	0x43
+#define SPURIOUS_VECTOR		0xff
+
+#define MP_SIGNATURE	(('_'<<24)|('P'<<16)|('M'<<8)|'_')
+#define MPC_SIGNATURE	(('P'<<24)|('M'<<16)|('C'<<8)|'P')
+
+#define MP_PROCESSOR	0
+#define MP_BUS		1
+#define MP_IOAPIC	2
+#define MP_INTSRC	3
+#define MP_LINTSRC	4
+
+struct mp_floating {
+	unsigned long signature;
+	unsigned long physptr;		/* config table, 0 for a default one */
+	unsigned char length;		/* in 16 bytes */
+	unsigned char specification;
+	unsigned char checksum;
+	unsigned char feature1;
+	unsigned char feature2;		/* bit 7: the IMCR is there */
+	unsigned char feature3[3];
+};
+
+struct mp_config {
+	unsigned long signature;
+	unsigned short length;
+	unsigned char specification;
+	unsigned char checksum;
+	char oem[8];
+	char product[12];
+	unsigned long oem_table;
+	unsigned short oem_length;
+	unsigned short count;
+	unsigned long lapic;
+	unsigned short ext_length;
+	unsigned char ext_checksum;
+	unsigned char reserved;
+};
+
+struct mp_processor {
+	unsigned char type, apicid, apicver, flags;	/* 1: enabled, 2: boot */
+	unsigned long signature, features, reserved[2];
+};
+
+struct mp_bus {
+	unsigned char type, busid;
+	char name[6];
+};
+
+struct mp_ioapic {
+	unsigned char type, apicid, apicver, flags;
+	unsigned long addr;
+};
+
+struct mp_intsrc {
+	unsigned char type, irqtype;
+	unsigned short flags;		/* polarity, then trigger mode */
+	unsigned char srcbus, srcbusirq, dstapic, dstirq;
+};
+
+extern void local_timer_interrupt(void);
+extern void reschedule_interrupt(void);
+extern void invalidate_interrupt(void);
+extern void spurious_interrupt(void);
+extern char trampoline_start[], trampoline_end[];
+
+int smp_num_cpus = 1;
+unsigned long apic_base = 0;
+unsigned long io_apic_irqs = 0;		/* the irqs the IO-APIC delivers */
+unsigned long ap_cr0, ap_cr4, ap_stack;	/* for trampoline.s */
+
+static int cpu_apicid[NR_CPUS];
+static int mp_apicids[NR_CPUS];
+static int mp_nr_cpus = 0;
+static unsigned long mp_lapic = 0;
+static unsigned long io_apic_phys = 0, io_apic_base;
+static int io_apic_id;
+static unsigned long isa_buses = 0;
+static int irq_pin[16] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
+static unsigned short irq_flags[16];
+static int imcr = 0;
+static unsigned long apic_timer_count;
+static volatile int ap_called_in;
+static volatile unsigned long invalidate_needed = 0;
+static spinlock_t kernel_flag = SPIN_LOCK_UNLOCKED;
+static char trampoline_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+/*
+ * Interrupts are off while lock_depth and the lock disagree, or an
+ * interrupt on this cpu could find the lock taken by "someone else" and
+ * spin for ever. While spinning they are as they were, but a cpu that
+ * holds the lock may be waiting for us to flush our tlb, so that is done
+ * here too.
+ */
+void lock_kernel(void)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	if (!current->lock_depth)
+		while (!spin_trylock(&kernel_flag)) {
+			restore_flags(flags);
+			while (kernel_flag.lock) {
+				smp_invalidate();
+				cpu_relax();
+			}
+			cli();
+		}
+	current->lock_depth++;
+	restore_flags(flags);
+}
+
+void unlock_kernel(void)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	if (!--current->lock_depth)
+		spin_unlock(&kernel_flag);
+	restore_flags(flags);
+}
+
+static void send_ipi(int apicid, unsigned long icr)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	while (apic_read(APIC_ICR) & 0x1000)	/* still sending the last */
+		cpu_relax();
+	apic_write(APIC_ICR2,apicid << 24);
+	apic_write(APIC_ICR,icr);
+	restore_flags(flags);
+}
+
+void smp_invalidate(void)
+{
+	unsigned long cpu = smp_processor_id(), old;
+
+	__asm__ __volatile__("lock ; btrl %2,%1\n\t"
+		"sbbl %0,%0"
+		:"=r" (old),"+m" (invalidate_needed)
+		:"r" (cpu):"memory");
+	if (old)
+		__invalidate();
+}
+
+/*
+ * flush_tlb() is invalidate() now: the other cpus may be running on the
+ * same page tables, so they are told to flush theirs too, and we wait
+ * until they have. We have the kernel lock, so they can only be in user
+ * mode, idle, or spinning on the lock, which looks out for this.
+ */
+void flush_tlb(void)
+{
+	unsigned long mask;
+
+	__invalidate();
+	if (smp_num_cpus < 2)
+		return;
+	mask = ((1 << smp_num_cpus) - 1) & ~(1 << smp_processor_id());
+	__asm__ __volatile__("lock ; orl %1,%0"
+		:"+m" (invalidate_needed):"r" (mask):"memory");
+	send_ipi(0,0xc0000 | INVALIDATE_VECTOR);	/* all but self */
+	while (invalidate_needed & mask)
+		cpu_relax();
+}
+
+/*
+ * smp_wake_idle() gets a cpu that is idle out of its hlt to look for
+ * work: a task just became runnable.
+ */
+void smp_wake_idle(void)
+{
+	int i;
+
+	for (i = 0 ; i < smp_num_cpus ; i++)
+		if (i != smp_processor_id() && is_idle_task(cpu_curr[i])) {
+			send_ipi(cpu_apicid[i],RESCHEDULE_VECTOR);
+			return;
+		}
+}
+
+static int mp_checksum(unsigned char * p, int len)
+{
+	unsigned char sum = 0;
+
+	while (len--)
+		sum += *p++;
+	return sum;
+}
+
+static struct mp_floating * mp_find(unsigned long base, unsigned long length)
+{
+	struct mp_floating * mpf = (struct mp_floating *) base;
+
+	for ( ; length >= 16 ; mpf++, length -= 16)
+		if (mpf->signature == MP_SIGNATURE &&
+		    !mp_checksum((unsigned char *) mpf,16*mpf->length))
+			return mpf;
+	return NULL;
+}
+
+/*
+ * mp_parse() picks out what we need from the config table while it is
+ * still there: the buffer cache goes up to 640kB and may cover it later.
+ */
+static int mp_parse(struct mp_config * mpc)
+{
+	unsigned char * p = (unsigned char *) (mpc+1);
+	struct mp_processor * cpu;
+	struct mp_bus * bus;
+	struct mp_ioapic * ioapic;
+	struct mp_intsrc * intsrc;
+	int i;
+
+	if (mpc->signature != MPC_SIGNATURE ||
+	    mp_checksum((unsigned char *) mpc,mpc->length))
+		return 0;
+	mp_lapic = mpc->lapic;
+	for (i = 0 ; i < mpc->count ; i++)
+		switch (*p) {
+			case MP_PROCESSOR:
+				cpu = (struct mp_processor *) p;
+				if ((cpu->flags & 1) && mp_nr_cpus < NR_CPUS)
+					mp_apicids[mp_nr_cpus++] = cpu->apicid;
+				p += sizeof(*cpu);
+				break;
+			case MP_BUS:
+				bus = (struct mp_bus *) p;
+				if (bus->busid < 32 && (
+				    (bus->name[0]=='I' && bus->name[1]=='S' &&
+				     bus->name[2]=='A') ||
+				    (bus->name[0]=='E' && bus->name[1]=='I' &&
+				     bus->name[2]=='S' && bus->name[3]=='A')))
+					isa_buses |= 1 << bus->busid;
+				p += sizeof(*bus);
+				break;
+			case MP_IOAPIC:
+				ioapic = (struct mp_ioapic *) p;
+				if ((ioapic->flags & 1) && !io_apic_phys) {
+					io_apic_phys = ioapic->addr;
+					io_apic_id = ioapic->apicid;
+				}
+				p += sizeof(*ioapic);
+				break;
+			case MP_INTSRC:
+				intsrc = (struct mp_intsrc *) p;
+				if (!intsrc->irqtype && intsrc->srcbus < 32 &&
+				    (isa_buses & (1 << intsrc->srcbus)) &&
+				    intsrc->dstapic == io_apic_id &&
+				    intsrc->srcbusirq < 16) {
+					irq_pin[intsrc->srcbusirq] = intsrc->dstirq;
+					irq_flags[intsrc->srcbusirq] = intsrc->flags;
+				}
+				p += sizeof(*intsrc);
+				break;
+			case MP_LINTSRC:
+				p += 8;
+				break;
+			default:
+				return 1;
+		}
+	return 1;
+}
+
+static void setup_local_apic(void)
+{
+	apic_write(APIC_TPR,0);
+	apic_write(APIC_SVR,0x100 | SPURIOUS_VECTOR);	/* enabled */
+}
+
+/* the local APIC timer counts the bus clock, divided by 16 here */
+static void calibrate_apic_timer(void)
+{
+	apic_write(APIC_TDCR,0x3);
+	apic_write(APIC_LVTT,0x10000 | LOCAL_TIMER_VECTOR);	/* masked */
+	apic_write(APIC_TMICT,0xffffffff);
+	udelay(1000000/HZ);
+	apic_timer_count = 0xffffffff - apic_read(APIC_TMCCT);
+	apic_write(APIC_TMICT,0);
+}
+
+static void setup_apic_timer(void)
+{
+	apic_write(APIC_TDCR,0x3);
+	apic_write(APIC_LVTT,0x20000 | LOCAL_TIMER_VECTOR);	/* periodic */
+	apic_write(APIC_TMICT,apic_timer_count);
+}
+
+static void io_apic_write(int reg, unsigned long val)
+{
+	*(volatile unsigned long *) io_apic_base = reg;
+	*(volatile unsigned long *) (io_apic_base+0x10) = val;
+}
+
+/*
+ * setup_io_apic() routes the irqs the drivers have unmasked in the 8259s
+ * to the same vectors on the boot cpu, and masks the 8259s. The handlers
+ * still send them an EOI, which does no harm.
+ */
+static void setup_io_apic(void)
+{
+	unsigned long low, mask;
+	int irq;
+
+	mask = inb_p(0x21) | (inb_p(0xA1) << 8);
+	for (irq = 0 ; irq < 16 ; irq++) {
+		if (irq == 2 || (mask & (1 << irq)) || irq_pin[irq] < 0)
+			continue;
+		low = 0x20 + irq;
+		if ((irq_flags[irq] & 3) == 3)
+			low |= 0x2000;			/* active low */
+		if (((irq_flags[irq] >> 2) & 3) == 3)
+			low |= 0x8000;			/* level triggered */
+		io_apic_write(0x11+2*irq_pin[irq],cpu_apicid[0] << 24);
+		io_apic_write(0x10+2*irq_pin[irq],low);
+		io_apic_irqs |= 1 << irq;
+	}
+	if (!io_apic_irqs)
+		return;
+	if (imcr) {
+		outb_p(0x70,0x22);			/* IMCR: to the APIC */
+		outb_p(0x01,0x23);
+	}
+	outb_p(0xff,0x21);
+	outb(0xff,0xA1);
+	apic_write(APIC_LINT0,0x10700);			/* ExtINT, masked */
+}
+
+/*
+ * smp_callin() is where the other cpus come in, from trampoline.s. Each
+ * ends up in the idle loop, which gives up the kernel lock while it waits.
+ */
+void smp_callin(void)
+{
+	tss_init(smp_processor_id());
+	setup_local_apic();
+	setup_apic_timer();
+	ap_called_in = 1;
+	lock_kernel();
+	for (;;) {
+		cpu_idle();
+		schedule();
+	}
+}
+
+/*
+ * boot_ap() gives the cpu an idle task, a copy of task 0, and wakes it
+ * with INIT and two STARTUPs at the trampoline page, as Intel says to.
+ */
+static int boot_ap(int apicid)
+{
+	struct task_struct * p;
+	int cpu = smp_num_cpus, i;
+
+	if (!(p = (struct task_struct *) get_free_page()))
+		return 0;
+	*p = *idle_task[0];
+	p->processor = cpu;
+	p->lock_depth = 0;
+	idle_task[cpu] = cpu_curr[cpu] = p;
+	ap_stack = PAGE_SIZE + (unsigned long) p;
+	ap_called_in = 0;
+	send_ipi(apicid,0xc500);			/* INIT, assert */
+	udelay(200);
+	send_ipi(apicid,0x8500);			/* INIT, deassert */
+	udelay(10000);
+	for (i = 0 ; i < 2 && !ap_called_in ; i++) {
+		send_ipi(apicid,0x600 | ((unsigned long) trampoline_page >> 12));
+		udelay(200);
+	}
+	for (i = 0 ; i < 1000 && !ap_called_in ; i++)
+		udelay(1000);
+	if (!ap_called_in) {
+		idle_task[cpu] = cpu_curr[cpu] = NULL;
+		free_page((unsigned long) p);
+		return 0;
+	}
+	cpu_apicid[cpu] = apicid;
+	smp_num_cpus++;
+	return 1;
+}
+
+void smp_init(void)
+{
+	struct mp_floating * mpf;
+	char * from, * to;
+	int i;
+
+	if (!(cpu_features & CPU_APIC))
+		return;
+	if (!(mpf = mp_find(0x9fc00,0x400)) && !(mpf = mp_find(0xf0000,0x10000)))
+		return;
+	if (!mpf->physptr) {
+		printk("SMP: default MP configurations not supported\n\r");
+		return;
+	}
+	if (!mp_parse((struct mp_config *) mpf->physptr))
+		return;
+	imcr = mpf->feature2 & 0x80;
+	apic_base = ioremap(mp_lapic);
+	cpu_apicid[0] = apic_read(APIC_ID) >> 24;
+	setup_local_apic();
+	set_intr_gate(LOCAL_TIMER_VECTOR,&local_timer_interrupt);
+	set_intr_gate(RESCHEDULE_VECTOR,&reschedule_interrupt);
+	set_intr_gate(INVALIDATE_VECTOR,&invalidate_interrupt);
+	set_intr_gate(SPURIOUS_VECTOR,&spurious_interrupt);
+	calibrate_apic_timer();
+	for (from = trampoline_start, to = trampoline_page ;
+	     from < trampoline_end ; )
+		*to++ = *from++;
+	__asm__("movl %%cr0,%0":"=r" (ap_cr0));
+	__asm__("movl %%cr4,%0":"=r" (ap_cr4));
+	ap_cr0 &= ~8;					/* TS */
+	for (i = 0 ; i < mp_nr_cpus && smp_num_cpus < NR_CPUS ; i++)
+		if (mp_apicids[i] != cpu_apicid[0] && !boot_ap(mp_apicids[i]))
+			printk("SMP: cpu with APIC id %d didn't start\n\r",
+				mp_apicids[i]);
+	if (io_apic_phys) {
+		io_apic_base = ioremap(io_apic_phys);
+		setup_io_apic();
+	}
+	printk("SMP: %d cpus\n\r",smp_num_cpus);
+}
@@ -43,9 +43,38 @@ int sys_rename()
 	return -ENOSYS;
 }
 
-int sys_prof()
+/*
+ * sys_prof() is profil(): every tick the process spends in user mode at
+ * 'pc' adds one to the unsigned short at byte offset
+ * ((pc-offset)*scale/65536) & ~1 in 'buf', if that is below 'bufsiz'.
+ * A scale of 0 or 1 turns it off. Forks keep it, exec turns it off.
+ * The buffer is paged in here, see profile_tick() in sched.c.
+ *
+ * Only three arguments come in registers, so 'args' points to all four.
+ */
+int sys_prof(unsigned long * args)
 {
-	return -ENOSYS;
+	char * buf, * p;
+	unsigned long bufsiz, offset, scale;
+
+	buf = (char *) get_fs_long(args);
+	bufsiz = get_fs_long(args+1);
+	offset = get_fs_long(args+2);
+	scale = get_fs_long(args+3);
+	if (scale >= 2) {
+		if (((unsigned long) buf & 1) || bufsiz >= TASK_SIZE)
+			return -EINVAL;
+		for (p = buf ; p < buf+bufsiz ; p += PAGE_SIZE)
+			get_fs_byte(p);
+		if (bufsiz)
+			get_fs_byte(buf+bufsiz-1);
+		verify_area(buf,bufsiz);
+	}
+	current->prof_buf = (unsigned long) buf;
+	current->prof_size = bufsiz;
+	current->prof_off = offset;
+	current->prof_scale = scale;
+	return 0;
 }
 
 int sys_setregid(int rgid, int egid)
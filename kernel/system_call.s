@@ -14,6 +14,10 @@
  * don't handle signal-recognition, as that would clutter them up totally
  * unnecessarily.
  *
+ * Everything that comes in here takes the kernel lock, and the way out
+ * through ret_from_sys_call lets go of it again. The task struct of the
+ * current task is at the bottom of the stack page.
+ *
  * Stack layout in 'ret_from_system_call':
  *
  *	 0(%esp) - %eax
@@ -51,6 +55,7 @@ priority = 8
 signal	= 12
 sigaction = 16		# MUST be 16 (=len of sigaction)
 blocked = (33*16)
+need_resched = blocked+4
 
 # offsets within sigaction
 sa_handler = 0
@@ -58,15 +63,20 @@ sa_mask = 4
 sa_flags = 8
 sa_restorer = 12
 
-nr_system_calls = 74
+APIC_EOI	= 0xb0	# local APIC end of interrupt register
+
+nr_system_calls = 84
 
 /*
  * Ok, I get parallel printer interrupts while using the floppy for some
  * strange reason. Urgel. Now I just ignore them.
  */
-.globl system_call,sys_fork,timer_interrupt,sys_execve
+.globl system_call,sys_fork,timer_interrupt,sys_execve,ret_from_fork
+.globl sysenter_entry
 .globl hd_interrupt,floppy_interrupt,parallel_interrupt
 .globl device_not_available, coprocessor_error
+.globl apic_eoi,local_timer_interrupt,reschedule_interrupt
+.globl invalidate_interrupt,spurious_interrupt
 
 .align 2
 bad_sys_call:
@@ -91,16 +101,42 @@ system_call:
 	mov %dx,%es
 	movl $0x17,%edx		# fs points to local data space
 	mov %dx,%fs
+	pushl %eax
+	call lock_kernel
+	popl %eax
+sys_call:
+.ifdef CONFIG_TRACE
+	pushl %eax
+	pushl $0
+	pushl %eax
+	pushl $2		# TR_SYSCALL
+	call trace_event
+	addl $12,%esp
+	popl %eax
+.endif
 	call *sys_call_table(,%eax,4)
 	pushl %eax
-	movl current,%eax
+.ifdef CONFIG_TRACE
+	pushl $0
+	pushl %eax
+	pushl $3		# TR_SYSRET
+	call trace_event
+	addl $12,%esp
+.endif
+	movl $-4096,%eax		# current
+	andl %esp,%eax
 	cmpl $0,state(%eax)		# state
 	jne reschedule
 	cmpl $0,counter(%eax)		# counter
 	je reschedule
 ret_from_sys_call:
-	movl current,%eax		# task[0] cannot have signals
-	cmpl task,%eax
+	movl $-4096,%eax
+	andl %esp,%eax
+	cmpl $0,need_resched(%eax)	# somebody woken up should run first?
+	je 1f
+	testl $3,CS(%esp)		# only when going back to user mode
+	jne reschedule
+1:	cmpl task,%eax			# task[0] cannot have signals
 	je 3f
 	cmpw $0x0f,CS(%esp)		# was old code segment supervisor ?
 	jne 3f
@@ -118,7 +154,8 @@ ret_from_sys_call:
 	pushl %ecx
 	call do_signal
 	popl %eax
-3:	popl %eax
+3:	call unlock_kernel
+	popl %eax
 	popl %ebx
 	popl %ecx
 	popl %edx
@@ -127,6 +164,46 @@ ret_from_sys_call:
 	pop %ds
 	iret
 
+/*
+ * sysenter_entry is the fast way in, see lib/syscall.c. The cpu gives
+ * us nothing but a stack pointer, just past esp0 in the TSS of this cpu:
+ * build the same frame int 0x80 would have, with the user %eip and %ebp
+ * the stub left on its stack, and go back through ret_from_sys_call
+ * with iret. sysexit can't be used, as it assumes flat user segments.
+ */
+.align 2
+sysenter_entry:
+	movl -4(%esp),%esp	# esp0, through %ss: %ds is the user's
+	sti
+	pushl $0x17		# ss
+	pushl %ebp		# esp, fixed below
+	pushfl
+	pushl $0x0f		# cs
+	pushl $0		# eip, fixed below
+	push %ds
+	push %es
+	push %fs
+	pushl %edx
+	pushl %ecx
+	pushl %ebx
+	movl $0x10,%edx
+	mov %dx,%ds
+	mov %dx,%es
+	movl $0x17,%edx
+	mov %dx,%fs
+	movl %fs:4(%ebp),%edx	# return address
+	movl %edx,EIP-4(%esp)
+	leal 8(%ebp),%edx
+	movl %edx,OLDESP-4(%esp)
+	movl %fs:(%ebp),%ebp	# and the user's %ebp
+	pushl %eax
+	call lock_kernel
+	popl %eax
+	cmpl $nr_system_calls-1,%eax
+	jbe sys_call
+	pushl $-1
+	jmp ret_from_sys_call
+
 .align 2
 coprocessor_error:
 	push %ds
@@ -141,6 +218,7 @@ coprocessor_error:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+	call lock_kernel
 	pushl $ret_from_sys_call
 	jmp math_error
 
@@ -158,6 +236,7 @@ device_not_available:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+	call lock_kernel
 	pushl $ret_from_sys_call
 	clts				# clear TS so that we can use math
 	movl %cr0,%eax
@@ -189,11 +268,14 @@ timer_interrupt:
 	incl jiffies
 	movb $0x20,%al		# EOI to interrupt controller #1
 	outb %al,$0x20
-	movl CS(%esp),%eax
+	call apic_eoi
+	call lock_kernel
+	pushl EIP(%esp)		# for the profile
+	movl CS+4(%esp),%eax
 	andl $3,%eax		# %eax is CPL (0 or 3, 0=supervisor)
 	pushl %eax
 	call do_timer		# 'do_timer(long CPL)' does everything from
-	addl $4,%esp		# task switching to accounting ...
+	addl $8,%esp		# task switching to accounting ...
 	jmp ret_from_sys_call
 
 .align 2
@@ -218,6 +300,20 @@ sys_fork:
 	addl $20,%esp
 1:	ret
 
+/*
+ * A new child starts here on its first switch_to(), with the stack set
+ * up by copy_process(). %fs may still hold the parent's idea of 0x17.
+ */
+.align 2
+ret_from_fork:
+	popl %ebp
+	popl %edi
+	popl %esi
+	pop %gs
+	movl $0x17,%eax
+	mov %ax,%fs
+	jmp ret_from_sys_call
+
 hd_interrupt:
 	pushl %eax
 	pushl %ecx
@@ -230,6 +326,7 @@ hd_interrupt:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+	call lock_kernel
 	movb $0x20,%al
 	outb %al,$0xA0		# EOI to interrupt controller #1
 	jmp 1f			# give port chance to breathe
@@ -240,7 +337,12 @@ hd_interrupt:
 	jne 1f
 	movl $unexpected_hd_interrupt,%edx
 1:	outb %al,$0x20
+	call apic_eoi
 	call *%edx		# "interesting" way of handling intr.
+	pushl 28(%esp)		# the interrupted cs
+	call intr_resched
+	addl $4,%esp
+	call unlock_kernel
 	pop %fs
 	pop %es
 	pop %ds
@@ -261,14 +363,20 @@ floppy_interrupt:
 	mov %ax,%es
 	movl $0x17,%eax
 	mov %ax,%fs
+	call lock_kernel
 	movb $0x20,%al
 	outb %al,$0x20		# EOI to interrupt controller #1
+	call apic_eoi
 	xorl %eax,%eax
 	xchgl do_floppy,%eax
 	testl %eax,%eax
 	jne 1f
 	movl $unexpected_floppy_interrupt,%eax
 1:	call *%eax		# "interesting" way of handling intr.
+	pushl 28(%esp)		# the interrupted cs
+	call intr_resched
+	addl $4,%esp
+	call unlock_kernel
 	pop %fs
 	pop %es
 	pop %ds
@@ -282,4 +390,102 @@ parallel_interrupt:
 	movb $0x20,%al
 	outb %al,$0x20
 	popl %eax
+	call apic_eoi
+	iret
+
+/*
+ * When the IO-APIC delivers the interrupts, the local APIC wants an EOI
+ * as well as the 8259s. apic_eoi does that, changing nothing but flags.
+ */
+.align 2
+apic_eoi:
+	cmpl $0,io_apic_irqs
+	je 1f
+	pushl %eax
+	movl apic_base,%eax
+	movl $0,APIC_EOI(%eax)
+	popl %eax
+1:	ret
+
+/*
+ * The interrupts of the local APIC. Its timer does for the other cpus
+ * what do_timer() does for the boot cpu, without the global parts. The
+ * tlb flush of another cpu doesn't take the kernel lock, as that cpu
+ * has it: see flush_tlb() in smp.c.
+ */
+.align 2
+local_timer_interrupt:
+	push %ds
+	push %es
+	push %fs
+	pushl %edx
+	pushl %ecx
+	pushl %ebx
+	pushl %eax
+	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	movl $0x17,%eax
+	mov %ax,%fs
+	movl apic_base,%eax
+	movl $0,APIC_EOI(%eax)
+	call lock_kernel
+	pushl EIP(%esp)
+	movl CS+4(%esp),%eax
+	andl $3,%eax
+	pushl %eax
+	call update_process_times
+	addl $8,%esp
+	jmp ret_from_sys_call
+
+.align 2
+reschedule_interrupt:
+	pushl %eax
+	pushl %ecx
+	pushl %edx
+	push %ds
+	push %es
+	push %fs
+	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	movl $0x17,%eax
+	mov %ax,%fs
+	movl apic_base,%eax
+	movl $0,APIC_EOI(%eax)
+	call lock_kernel
+	pushl 28(%esp)		# the interrupted cs
+	call intr_resched
+	addl $4,%esp
+	call unlock_kernel
+	pop %fs
+	pop %es
+	pop %ds
+	popl %edx
+	popl %ecx
+	popl %eax
 	iret
+
+.align 2
+invalidate_interrupt:
+	pushl %eax
+	pushl %ecx
+	pushl %edx
+	push %ds
+	movl $0x10,%eax
+	mov %ax,%ds
+	call smp_invalidate
+	movl apic_base,%eax
+	movl $0,APIC_EOI(%eax)
+	pop %ds
+	popl %edx
+	popl %ecx
+	popl %eax
+	iret
+
+/* no EOI for these */
+.align 2
+spurious_interrupt:
+	iret
+
+.section .note.GNU-stack,"",@progbits
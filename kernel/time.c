@@ -0,0 +1,269 @@
+/*
+ *  linux/kernel/time.c
+ */
+
+/*
+ * time.c keeps the time to the microsecond, for gettimeofday() and
+ * clock_gettime(), and has nanosleep().
+ *
+ * If the cpu has a time stamp counter, it is the clock: tsc_init() times
+ * it against the PIT at boot, and the time is simply the cycles since
+ * then, scaled. Otherwise it is jiffies, plus how far the PIT has got
+ * into the current tick. Either way the monotonic clock starts at boot,
+ * and the real time is startup_time added to it.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+#include <asm/io.h>
+
+#define CLOCK_TICK_RATE 1193180
+#define LATCH (CLOCK_TICK_RATE/HZ)
+#define USEC_PER_TICK (1000000/HZ)
+#define NSEC_PER_TICK (1000000000/HZ)
+
+/* 50ms on PIT channel 2 */
+#define CALIBRATE_MS 50
+#define CALIBRATE_LATCH (CLOCK_TICK_RATE*CALIBRATE_MS/1000)
+
+extern long idle_ticks;
+
+static unsigned long long tsc_base = 0;
+static unsigned long tsc_quotient = 0;	/* usecs per cycle, times 2^32 */
+unsigned long tsc_khz = 0;		/* 0 if the TSC isn't the clock */
+
+/*
+ * div_long() divides a 64-bit number by a long, as long as the quotient
+ * fits in a long. We don't link with libgcc.
+ */
+static inline unsigned long div_long(unsigned long long n, unsigned long base,
+	unsigned long * rem)
+{
+	unsigned long q, r;
+
+	__asm__("divl %4"
+		:"=a" (q),"=d" (r)
+		:"0" ((unsigned long) n),"1" ((unsigned long) (n>>32)),
+		 "rm" (base));
+	*rem = r;
+	return q;
+}
+
+void tsc_init(void)
+{
+	unsigned long long start;
+	unsigned long cycles, rem;
+	unsigned char gate;
+
+	if (!(cpu_features & CPU_TSC))
+		return;
+	gate = inb_p(0x61);
+	outb_p((gate & ~0x02) | 0x01,0x61);	/* gate on, speaker off */
+	outb_p(0xb0,0x43);			/* binary, mode 0, LSB/MSB, ch 2 */
+	outb_p(CALIBRATE_LATCH & 0xff,0x42);
+	outb(CALIBRATE_LATCH >> 8,0x42);
+	start = rdtsc();
+	while (!(inb(0x61) & 0x20))
+		/* nothing */;
+	tsc_base = rdtsc();
+	outb_p(gate,0x61);
+	cycles = tsc_base - start;
+	if (cycles <= CALIBRATE_MS*1000) {
+		printk("TSC too slow to use\n\r");
+		return;
+	}
+	tsc_quotient = div_long((unsigned long long) (CALIBRATE_MS*1000) << 32,
+		cycles,&rem);
+	tsc_khz = cycles/CALIBRATE_MS;
+	printk("TSC: %d kHz\n\r",tsc_khz);
+}
+
+/*
+ * udelay() waits at least 'usecs' microseconds, on the TSC if there is
+ * one and on PIT channel 2 if not. It works with interrupts off, so it
+ * is good for waiting on hardware during setup. Keep it under a second.
+ */
+void udelay(unsigned long usecs)
+{
+	unsigned long long end;
+	unsigned long count, rem;
+	unsigned char gate;
+
+	if (tsc_quotient) {
+		end = rdtsc() + div_long((unsigned long long) usecs << 32,
+			tsc_quotient,&rem);
+		while (rdtsc() < end)
+			/* nothing */;
+		return;
+	}
+	while (usecs) {
+		count = usecs < 50000 ? usecs : 50000;
+		usecs -= count;
+		count = count * (CLOCK_TICK_RATE/1000) / 1000 + 1;
+		gate = inb_p(0x61);
+		outb_p((gate & ~0x02) | 0x01,0x61);
+		outb_p(0xb0,0x43);
+		outb_p(count & 0xff,0x42);
+		outb(count >> 8,0x42);
+		while (!(inb(0x61) & 0x20))
+			/* nothing */;
+		outb_p(gate,0x61);
+	}
+}
+
+/*
+ * pit_usecs() is how far the PIT has counted since jiffies last went up.
+ * A pending timer interrupt with a count that has just started over
+ * means a tick jiffies doesn't know about yet. In tickless idle the PIT
+ * counts down idle_ticks ticks in one go.
+ */
+static unsigned long pit_usecs(void)
+{
+	unsigned long count, ticks;
+
+	if ((ticks = idle_ticks)) {
+		outb_p(0xc2,0x43);		/* read back status and count */
+		if (inb_p(0x40) & 0x80) {
+			inb_p(0x40);
+			inb_p(0x40);
+			return ticks*USEC_PER_TICK;
+		}
+	} else {
+		ticks = 1;
+		outb_p(0x00,0x43);		/* latch count, ch 0 */
+	}
+	count = inb_p(0x40);
+	count |= inb_p(0x40) << 8;
+	count = ticks*LATCH - count;
+	if (!idle_ticks && count < LATCH/2) {
+		outb_p(0x0a,0x20);		/* read irr */
+		if (inb_p(0x20) & 0x01)
+			count += LATCH;
+	}
+	return count * 1000 / (CLOCK_TICK_RATE/1000);
+}
+
+/*
+ * do_gettime() gives the time since boot.
+ */
+static void do_gettime(struct timeval * tv)
+{
+	unsigned long long usec;
+	unsigned long long cycles;
+	unsigned long flags, rem;
+
+	if (tsc_quotient) {
+		cycles = rdtsc() - tsc_base;
+		usec = (((unsigned long long) (unsigned long) cycles
+			* tsc_quotient) >> 32)
+			+ (unsigned long long) (unsigned long) (cycles >> 32)
+			* tsc_quotient;
+		tv->tv_sec = div_long(usec,1000000,&rem);
+		tv->tv_usec = rem;
+		return;
+	}
+	save_flags(flags);
+	cli();
+	tv->tv_sec = jiffies / HZ;
+	tv->tv_usec = (jiffies % HZ) * USEC_PER_TICK + pit_usecs();
+	restore_flags(flags);
+	while (tv->tv_usec >= 1000000) {
+		tv->tv_usec -= 1000000;
+		tv->tv_sec++;
+	}
+}
+
+int sys_gettimeofday(struct timeval * tv, struct timezone * tz)
+{
+	struct timeval now;
+
+	if (tv) {
+		do_gettime(&now);
+		verify_area(tv,sizeof *tv);
+		put_fs_long(startup_time + now.tv_sec,
+			(unsigned long *) &tv->tv_sec);
+		put_fs_long(now.tv_usec,(unsigned long *) &tv->tv_usec);
+	}
+	if (tz) {
+		verify_area(tz,sizeof *tz);
+		put_fs_long(0,(unsigned long *) &tz->tz_minuteswest);
+		put_fs_long(0,(unsigned long *) &tz->tz_dsttime);
+	}
+	return 0;
+}
+
+int sys_clock_gettime(int clock_id, struct timespec * tp)
+{
+	struct timeval now;
+
+	if (clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC)
+		return -EINVAL;
+	do_gettime(&now);
+	if (clock_id == CLOCK_REALTIME)
+		now.tv_sec += startup_time;
+	verify_area(tp,sizeof *tp);
+	put_fs_long(now.tv_sec,(unsigned long *) &tp->tv_sec);
+	put_fs_long(now.tv_usec*1000,(unsigned long *) &tp->tv_nsec);
+	return 0;
+}
+
+/*
+ * process_timeout() is the timer for a task that sleeps with a time
+ * limit: it wakes the task if it is still asleep.
+ */
+void process_timeout(unsigned long data)
+{
+	struct task_struct * p = (struct task_struct *) data;
+
+	if (p->state == TASK_INTERRUPTIBLE)
+		p->state = TASK_RUNNING;
+}
+
+/*
+ * sys_nanosleep() sleeps on the timer list, so it is rounded up to whole
+ * ticks, plus one for the tick we're already in. A signal ends it early,
+ * with the time left in 'rmtp'.
+ */
+int sys_nanosleep(const struct timespec * rqtp, struct timespec * rmtp)
+{
+	long sec, nsec, ticks, expires;
+	unsigned long flags;
+	int woken;
+
+	sec = get_fs_long((unsigned long *) &rqtp->tv_sec);
+	nsec = get_fs_long((unsigned long *) &rqtp->tv_nsec);
+	if (sec < 0 || nsec < 0 || nsec >= 1000000000)
+		return -EINVAL;
+	if (sec >= 0x7fffffff/HZ - 1)
+		sec = 0x7fffffff/HZ - 2;
+	ticks = sec*HZ + (nsec + NSEC_PER_TICK - 1) / NSEC_PER_TICK;
+	if (!ticks)
+		return 0;
+	ticks++;
+	save_flags(flags);
+	cli();
+	expires = jiffies + ticks;
+	current->state = TASK_INTERRUPTIBLE;
+	add_timer_data(ticks,process_timeout,(unsigned long) current);
+	schedule();
+	woken = del_timer(process_timeout,(unsigned long) current);
+	restore_flags(flags);
+	if (!woken)
+		return 0;
+	if (rmtp) {
+		ticks = expires - jiffies;
+		if (ticks < 0)
+			ticks = 0;
+		verify_area(rmtp,sizeof *rmtp);
+		put_fs_long(ticks / HZ,(unsigned long *) &rmtp->tv_sec);
+		put_fs_long((ticks % HZ) * NSEC_PER_TICK,
+			(unsigned long *) &rmtp->tv_nsec);
+	}
+	return -EINTR;
+}
@@ -0,0 +1,97 @@
+/*
+ *  linux/kernel/trace.c
+ */
+
+/*
+ * The tracepoint ring, see <linux/trace.h>. trace_event() takes its slot
+ * with a locked xadd, so it needs no lock and can be called from any
+ * context: an interrupt taking a slot while a task is filling one in
+ * just gets the next one. Once the ring is full the oldest events go,
+ * and trace() skips to what is left.
+ */
+
+#include <errno.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/trace.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#ifdef CONFIG_TRACE
+
+#define TRACE_EVENTS	2048		/* a power of two */
+
+extern unsigned long tsc_khz;
+
+static struct trace_event trace_buf[TRACE_EVENTS];
+static volatile unsigned long trace_head = 0;	/* next slot to fill */
+static unsigned long trace_tail = 0;		/* next one trace() reads */
+static int trace_on = 1;
+
+void trace_event(int type, long a, long b)
+{
+	struct trace_event * e;
+	unsigned long slot = 1;
+
+	if (!trace_on)
+		return;
+	__asm__ __volatile__("lock ; xaddl %0,%1"
+		:"+r" (slot),"+m" (trace_head)::"memory");
+	e = trace_buf + (slot & (TRACE_EVENTS-1));
+	e->tsc = tsc_khz ? rdtsc() : jiffies;
+	e->type = type;
+	e->cpu = smp_processor_id();
+	e->pid = current->pid;
+	e->a = a;
+	e->b = b;
+}
+
+int sys_trace(int cmd, struct trace_event * buf, int count)
+{
+	unsigned long head, * from, * to;
+	int i, j;
+
+	if (!suser())
+		return -EPERM;
+	switch (cmd) {
+		case TRACE_READ:
+			if (count < 0)
+				return -EINVAL;
+			if (count > TRACE_EVENTS)
+				count = TRACE_EVENTS;
+			verify_area(buf,count * sizeof *buf);
+			head = trace_head;
+			if (head - trace_tail > TRACE_EVENTS)
+				trace_tail = head - TRACE_EVENTS;
+			for (i = 0 ; i < count && trace_tail != head ; i++) {
+				from = (unsigned long *)
+					(trace_buf + (trace_tail++ & (TRACE_EVENTS-1)));
+				to = (unsigned long *) (buf + i);
+				for (j = 0 ; j < sizeof *buf / 4 ; j++)
+					put_fs_long(from[j],to+j);
+			}
+			return i;
+		case TRACE_CLEAR:
+			trace_tail = trace_head;
+			return 0;
+		case TRACE_STOP:
+			trace_on = 0;
+			return 0;
+		case TRACE_START:
+			trace_on = 1;
+			return 0;
+		case TRACE_KHZ:
+			return tsc_khz;
+	}
+	return -EINVAL;
+}
+
+#else
+
+int sys_trace(int cmd, struct trace_event * buf, int count)
+{
+	return -ENOSYS;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ *  linux/kernel/trampoline.s
+ */
+
+/*
+ * The other cpus start here, in real mode at the page smp_init() copied
+ * trampoline_start..trampoline_end to, with cs the page's segment. They
+ * go to protected mode on the kernel gdt, turn on paging as the boot cpu
+ * has it, and go to smp_callin() on the stack of their idle task.
+ */
+
+.globl trampoline_start,trampoline_end
+
+.code16
+trampoline_start:
+	cli
+	movw %cs,%ax
+	movw %ax,%ds
+	lgdtl ap_gdt_descr - trampoline_start
+	movl %cr0,%eax
+	orl $1,%eax		# PE
+	movl %eax,%cr0
+	ljmpl $0x08,$startup_ap
+.align 4
+ap_gdt_descr:
+	.word 256*8-1
+	.long gdt
+trampoline_end:
+
+.code32
+startup_ap:
+	movl $0x10,%eax
+	mov %ax,%ds
+	mov %ax,%es
+	mov %ax,%fs
+	mov %ax,%gs
+	mov %ax,%ss
+	lidt idt_descr
+	movl ap_cr4,%eax
+	movl %eax,%cr4		# PSE and PGE if the boot cpu has them
+	xorl %eax,%eax
+	movl %eax,%cr3		# pg_dir
+	movl ap_cr0,%eax
+	movl %eax,%cr0		# PG
+	jmp 1f
+1:	movl ap_stack,%esp
+	call smp_callin
+2:	jmp 2b
+
+.section .note.GNU-stack,"",@progbits
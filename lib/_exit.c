@@ -9,5 +9,5 @@
 
 void _exit(int exit_code)
 {
-	__asm__ __volatile__ ("int $0x80"::"a" (__NR_exit),"b" (exit_code));
+	__asm__ __volatile__ (__SYSCALL::"a" (__NR_exit),"b" (exit_code));
 }
@@ -29,12 +29,10 @@
  *	in sections of code where interrupts are turned off, to allow
  *	malloc() and free() to be safely called from an interrupt routine.
  *	(We will probably need this functionality when networking code,
- *	particularily things like NFS, is added to Linux.)  However, this
- *	presumes that get_free_page() and free_page() are interrupt-level
- *	safe, which they may not be once paging is added.  If this is the
- *	case, we will need to modify malloc() to keep a few unused pages
- *	"pre-allocated" so that it can safely draw upon those pages if
- * 	it is called from an interrupt routine.
+ *	particularily things like NFS, is added to Linux.)  Now that
+ *	get_free_page() may sleep to swap something out, we ask for
+ *	GFP_ATOMIC pages, which never do.  The interrupt flag is restored
+ *	rather than just turned on, so malloc() can be used during boot.
  *
  * 	Another concern is that get_free_page() should not sleep; if it 
  *	does, the code is carefully ordered so as to avoid any race 
@@ -99,7 +97,7 @@ static inline void init_bucket_desc()
 	struct bucket_desc *bdesc, *first;
 	int	i;
 	
-	first = bdesc = (struct bucket_desc *) get_free_page();
+	first = bdesc = (struct bucket_desc *) __get_free_page(GFP_ATOMIC);
 	if (!bdesc)
 		panic("Out of memory in init_bucket_desc()");
 	for (i = PAGE_SIZE/sizeof(struct bucket_desc); i > 1; i--) {
@@ -119,6 +117,7 @@ void *malloc(unsigned int len)
 	struct _bucket_dir	*bdir;
 	struct bucket_desc	*bdesc;
 	void			*retval;
+	unsigned long		flags;
 
 	/*
 	 * First we search the bucket_dir to find the right bucket change
@@ -135,6 +134,7 @@ void *malloc(unsigned int len)
 	/*
 	 * Now we search for a bucket descriptor which has free space
 	 */
+	save_flags(flags);
 	cli();	/* Avoid race conditions */
 	for (bdesc = bdir->chain; bdesc; bdesc = bdesc->next) 
 		if (bdesc->freeptr)
@@ -153,7 +153,7 @@ void *malloc(unsigned int len)
 		free_bucket_desc = bdesc->next;
 		bdesc->refcnt = 0;
 		bdesc->bucket_size = bdir->size;
-		bdesc->page = bdesc->freeptr = (void *) (cp = (char *) get_free_page());
+		bdesc->page = bdesc->freeptr = (void *) (cp = (char *) __get_free_page(GFP_ATOMIC));
 		if (!cp)
 			panic("Out of memory in kernel malloc()");
 		/* Set up the chain of free objects */
@@ -168,7 +168,7 @@ void *malloc(unsigned int len)
 	retval = (void *) bdesc->freeptr;
 	bdesc->freeptr = *((void **) retval);
 	bdesc->refcnt++;
-	sti();	/* OK, we're safe again */
+	restore_flags(flags);	/* OK, we're safe again */
 	return(retval);
 }
 
@@ -184,6 +184,7 @@ void free_s(void *obj, int size)
 	void		*page;
 	struct _bucket_dir	*bdir;
 	struct bucket_desc	*bdesc, *prev;
+	unsigned long		flags;
 	bdesc = prev = 0;
 	/* Calculate what page this object lives in */
 	page = (void *)  ((unsigned long) obj & 0xfffff000);
@@ -201,6 +202,7 @@ void free_s(void *obj, int size)
 	}
 	panic("Bad address passed to kernel free_s()");
 found:
+	save_flags(flags);
 	cli(); /* To avoid race conditions */
 	*((void **)obj) = bdesc->freeptr;
 	bdesc->freeptr = obj;
@@ -226,7 +228,7 @@ found:
 		bdesc->next = free_bucket_desc;
 		free_bucket_desc = bdesc;
 	}
-	sti();
+	restore_flags(flags);
 	return;
 }
 
@@ -0,0 +1,24 @@
+/*
+ *  linux/lib/profil.c
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+
+/*
+ * Only three arguments fit in registers, so the prof system call takes
+ * a pointer to a block of four longs: buf, bufsiz, offset and scale.
+ * See sys_prof() in kernel/sys.c.
+ */
+static _syscall1(int,prof,unsigned long *,args)
+
+int profil(char * buf, int bufsiz, int offset, int scale)
+{
+	unsigned long args[4];
+
+	args[0] = (unsigned long) buf;
+	args[1] = bufsiz;
+	args[2] = offset;
+	args[3] = scale;
+	return prof(args);
+}
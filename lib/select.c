@@ -0,0 +1,27 @@
+/*
+ *  linux/lib/select.c
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/time.h>
+
+/*
+ * Only three arguments fit in registers, so the select system call takes
+ * a pointer to a block of all five. See sys_select() in fs/select.c.
+ */
+#define __NR_select_block __NR_select
+static _syscall1(int,select_block,unsigned long *,args)
+
+int select(int n, fd_set * readfds, fd_set * writefds,
+	fd_set * exceptfds, struct timeval * timeout)
+{
+	unsigned long args[5];
+
+	args[0] = n;
+	args[1] = (unsigned long) readfds;
+	args[2] = (unsigned long) writefds;
+	args[3] = (unsigned long) exceptfds;
+	args[4] = (unsigned long) timeout;
+	return select_block(args);
+}
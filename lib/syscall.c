@@ -0,0 +1,63 @@
+/*
+ *  linux/lib/syscall.c
+ */
+
+/*
+ * The _syscallX() macros call *__syscall_vector with the call number in
+ * %eax and the arguments in %ebx, %ecx and %edx. Only %eax is changed.
+ *
+ * The first call finds out if the cpu has sysenter, the same way head.s
+ * does, and points the vector at the right entry for good. sysenter
+ * doesn't save the user's %eip and %esp: the kernel finds the return
+ * address and the old %ebp on the stack, at %ebp.
+ */
+__asm__(".text\n"
+".globl __syscall_vector\n"
+".data\n"
+".align 4\n"
+"__syscall_vector:\n\t"
+	".long __syscall_probe\n"
+".text\n"
+".align 4\n"
+"__syscall_int80:\n\t"
+	"int $0x80\n\t"
+	"ret\n"
+".align 4\n"
+"__syscall_sysenter:\n\t"
+	"pushl $1f\n\t"
+	"pushl %ebp\n\t"
+	"movl %esp,%ebp\n\t"
+	"sysenter\n"
+"1:\tret\n"
+".align 4\n"
+"__syscall_probe:\n\t"
+	"pushl %eax\n\t"
+	"pushl %ebx\n\t"
+	"pushl %ecx\n\t"
+	"pushl %edx\n\t"
+	"movl $__syscall_int80,__syscall_vector\n\t"
+	"pushfl\n\t"
+	"popl %eax\n\t"
+	"movl %eax,%ecx\n\t"
+	"xorl $0x200000,%eax\n\t"	/* ID bit: cpuid? */
+	"pushl %eax\n\t"
+	"popfl\n\t"
+	"pushfl\n\t"
+	"popl %eax\n\t"
+	"pushl %ecx\n\t"
+	"popfl\n\t"
+	"xorl %ecx,%eax\n\t"
+	"je 1f\n\t"
+	"movl $1,%eax\n\t"
+	"cpuid\n\t"
+	"testl $0x800,%edx\n\t"		/* SEP */
+	"je 1f\n\t"
+	"andl $0xfff,%eax\n\t"		/* not on early Pentium Pros */
+	"cmpl $0x633,%eax\n\t"
+	"jb 1f\n\t"
+	"movl $__syscall_sysenter,__syscall_vector\n"
+"1:\tpopl %edx\n\t"
+	"popl %ecx\n\t"
+	"popl %ebx\n\t"
+	"popl %eax\n\t"
+	"jmp *__syscall_vector");
@@ -27,6 +27,7 @@
 #include <linux/sched.h>
 #include <linux/head.h>
 #include <linux/kernel.h>
+#include <linux/trace.h>
 
 void do_exit(long code);
 
@@ -36,34 +37,32 @@ static inline void oom(void)
 	do_exit(SIGSEGV);
 }
 
-#define invalidate() \
-__asm__("movl %%eax,%%cr3"::"a" (0))
-
-/* these are not to be changed without changing head.s etc */
-#define LOW_MEM 0x100000
-#define PAGING_MEMORY (15*1024*1024)
-#define PAGING_PAGES (PAGING_MEMORY>>12)
-#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
-#define USED 100
-
 #define CODE_SPACE(addr) ((((addr)+4095)&~4095) < \
 current->start_code + current->end_code)
 
-static long HIGH_MEMORY = 0;
+long HIGH_MEMORY = 0;
 
 #define copy_page(from,to) \
 __asm__("cld ; rep ; movsl"::"S" (from),"D" (to),"c" (1024))
 
-static unsigned char mem_map [ PAGING_PAGES ] = {0,};
+unsigned char * mem_map = NULL;
+
+/* the page directory entry for 'address' in the current process */
+#define PDE(address) ((unsigned long *) current->tss.cr3 + ((address)>>22))
 
 /*
  * Get physical address of first (actually last :-) free page, and mark it
- * used. If no free pages left, return 0.
+ * used. If no free pages left, try to push something out to the swap
+ * area, and only return 0 if that doesn't work either.
+ *
+ * NOTE! This means get_free_page() can sleep when memory is tight,
+ * unless it's called with GFP_ATOMIC.
  */
-unsigned long get_free_page(void)
+unsigned long __get_free_page(int priority)
 {
 register unsigned long __res asm("ax");
 
+repeat:
 __asm__("std ; repne ; scasb\n\t"
 	"jne 1f\n\t"
 	"movb $1,1(%%edi)\n\t"
@@ -79,7 +78,9 @@ __asm__("std ; repne ; scasb\n\t"
 	:"0" (0),"i" (LOW_MEM),"c" (PAGING_PAGES),
 	"D" (mem_map+PAGING_PAGES-1)
 	);
-return __res;
+	if (!__res && priority == GFP_KERNEL && swap_out())
+		goto repeat;
+	return __res;
 }
 
 /*
@@ -99,28 +100,30 @@ void free_page(unsigned long addr)
 }
 
 /*
- * This function frees a continuos block of page tables, as needed
- * by 'exit()'. As does copy_page_tables(), this handles only 4Mb blocks.
+ * This function frees the user part of a page directory, as needed
+ * by 'exit()' and 'exec()'. The kernel part is shared by everybody, and
+ * the directory itself is freed by release().
  */
-int free_page_tables(unsigned long from,unsigned long size)
+int free_page_tables(struct task_struct * tsk)
 {
 	unsigned long *pg_table;
-	unsigned long * dir, nr;
+	unsigned long * dir, nr, size;
 
-	if (from & 0x3fffff)
-		panic("free_page_tables called with wrong alignment");
-	if (!from)
+	if (tsk->tss.cr3 == (unsigned long) pg_dir)
 		panic("Trying to free up swapper memory space");
-	size = (size + 0x3fffff) >> 22;
-	dir = (unsigned long *) ((from>>20) & 0xffc); /* _pg_dir = 0 */
-	for ( ; size-->0 ; dir++) {
+	dir = FIRST_USER_PGD + (unsigned long *) tsk->tss.cr3;
+	for (size = USER_PGDS ; size-->0 ; dir++) {
 		if (!(1 & *dir))
 			continue;
 		pg_table = (unsigned long *) (0xfffff000 & *dir);
 		for (nr=0 ; nr<1024 ; nr++) {
-			if (1 & *pg_table)
-				free_page(0xfffff000 & *pg_table);
-			*pg_table = 0;
+			if (*pg_table) {
+				if (1 & *pg_table)
+					free_page(0xfffff000 & *pg_table);
+				else
+					swap_free(*pg_table >> 1);
+				*pg_table = 0;
+			}
 			pg_table++;
 		}
 		free_page(0xfffff000 & *dir);
@@ -132,34 +135,39 @@ int free_page_tables(unsigned long from,unsigned long size)
 
 /*
  *  Well, here is one of the most complicated functions in mm. It
- * copies a range of linerar addresses by copying only the pages.
+ * copies the user part of the current page directory into the (empty)
+ * one of 'tsk' by copying only the pages, and shares the kernel part.
  * Let's hope this is bug-free, 'cause this one I don't want to debug :-)
  *
- * Note! We don't copy just any chunks of memory - addresses have to
- * be divisible by 4Mb (one page-directory entry), as this makes the
- * function easier. It's used only by fork anyway.
- *
- * NOTE 2!! When from==0 we are copying kernel space for the first
- * fork(). Then we DONT want to copy a full page-directory entry, as
- * that would lead to some serious memory waste - we just copy the
- * first 160 pages - 640kB. Even that is more than we need, but it
- * doesn't take any more memory - we don't copy-on-write in the low
- * 1 Mb-range, so the pages can be shared with the kernel. Thus the
- * special case for nr=xxxx.
+ * NOTE!! When current is task 0 we are copying kernel space for the
+ * first fork(). Then we DONT want to copy a full page-directory entry,
+ * as that would lead to some serious memory waste - we just copy the
+ * first 160 pages - 640kB - to the start of the new user space. Even
+ * that is more than we need, but it doesn't take any more memory - we
+ * don't copy-on-write in the low 1 Mb-range, so the pages can be shared
+ * with the kernel. Thus the special case for nr=xxxx.
  */
-int copy_page_tables(unsigned long from,unsigned long to,long size)
+int copy_page_tables(struct task_struct * tsk)
 {
 	unsigned long * from_page_table;
 	unsigned long * to_page_table;
-	unsigned long this_page;
+	unsigned long this_page, new_page;
 	unsigned long * from_dir, * to_dir;
-	unsigned long nr;
-
-	if ((from&0x3fffff) || (to&0x3fffff))
-		panic("copy_page_tables called with wrong alignment");
-	from_dir = (unsigned long *) ((from>>20) & 0xffc); /* _pg_dir = 0 */
-	to_dir = (unsigned long *) ((to>>20) & 0xffc);
-	size = ((unsigned) (size+0x3fffff)) >> 22;
+	unsigned long nr, size;
+
+	from_dir = (unsigned long *) current->tss.cr3;
+	to_dir = (unsigned long *) tsk->tss.cr3;
+	for (nr=0 ; nr<FIRST_USER_PGD ; nr++)
+		to_dir[nr] = pg_dir[nr];
+	for (nr=FIRST_USER_PGD+USER_PGDS ; nr<1024 ; nr++)
+		to_dir[nr] = pg_dir[nr];
+	to_dir += FIRST_USER_PGD;
+	if (from_dir == pg_dir)
+		size = 1;
+	else {
+		from_dir += FIRST_USER_PGD;
+		size = USER_PGDS;
+	}
 	for( ; size-->0 ; from_dir++,to_dir++) {
 		if (1 & *to_dir)
 			panic("copy_page_tables: already exist");
@@ -169,11 +177,28 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 		if (!(to_page_table = (unsigned long *) get_free_page()))
 			return -1;	/* Out of memory, see freeing */
 		*to_dir = ((unsigned long) to_page_table) | 7;
-		nr = (from==0)?0xA0:1024;
+		if (*from_dir & PAGE_PSE) {	/* task 0, with 4Mb pages */
+			for (nr=0 ; nr<0xA0 ; nr++)
+				to_page_table[nr] = (nr<<12) | 5;
+			continue;
+		}
+		nr = (from_dir==pg_dir)?0xA0:1024;
 		for ( ; nr-- > 0 ; from_page_table++,to_page_table++) {
 			this_page = *from_page_table;
-			if (!(1 & this_page))
+			if (!this_page)
+				continue;
+/*
+ * A swapped-out page stays in the swap area for the child, while the
+ * parent gets a private copy back in memory: swap slots aren't shared.
+ */
+			if (!(1 & this_page)) {
+				if (!(new_page = get_free_page()))
+					return -1;
+				read_swap_page(this_page>>1, (char *) new_page);
+				*to_page_table = this_page;
+				*from_page_table = new_page | (PAGE_DIRTY | 7);
 				continue;
+			}
 			this_page &= ~2;
 			*to_page_table = this_page;
 			if (this_page > LOW_MEM) {
@@ -198,13 +223,11 @@ unsigned long put_page(unsigned long page,unsigned long address)
 {
 	unsigned long tmp, *page_table;
 
-/* NOTE !!! This uses the fact that _pg_dir=0 */
-
 	if (page < LOW_MEM || page >= HIGH_MEMORY)
 		printk("Trying to put page %p at %p\n",page,address);
 	if (mem_map[(page-LOW_MEM)>>12] != 1)
 		printk("mem_map disagrees with %p at %p\n",page,address);
-	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	page_table = PDE(address);
 	if ((*page_table)&1)
 		page_table = (unsigned long *) (0xfffff000 & *page_table);
 	else {
@@ -218,11 +241,29 @@ unsigned long put_page(unsigned long page,unsigned long address)
 	return page;
 }
 
+/*
+ * put_dirty_page() is put_page() for pages the kernel has filled in
+ * behind the user's back (ie the argument pages in exec): they have no
+ * backing store, so they must never look clean to swap_out().
+ */
+unsigned long put_dirty_page(unsigned long page,unsigned long address)
+{
+	unsigned long *page_table;
+
+	if (!put_page(page,address))
+		return 0;
+	page_table = (unsigned long *) (0xfffff000 & *PDE(address));
+	page_table[(address>>12) & 0x3ff] |= PAGE_DIRTY;
+	return page;
+}
+
 void un_wp_page(unsigned long * table_entry)
 {
-	unsigned long old_page,new_page;
+	unsigned long old_page,new_page,entry;
 
-	old_page = 0xfffff000 & *table_entry;
+repeat:
+	entry = *table_entry;
+	old_page = 0xfffff000 & entry;
 	if (old_page >= LOW_MEM && mem_map[MAP_NR(old_page)]==1) {
 		*table_entry |= 2;
 		invalidate();
@@ -230,9 +271,20 @@ void un_wp_page(unsigned long * table_entry)
 	}
 	if (!(new_page=get_free_page()))
 		oom();
+/*
+ * get_free_page() may have slept in swap_out(), which is free to drop
+ * a clean shared page. Start over if the entry changed under us - the
+ * kernel can't rely on a fault for write_verify().
+ */
+	if (*table_entry != entry) {
+		free_page(new_page);
+		if ((3 & *table_entry) == 1)
+			goto repeat;
+		return;
+	}
 	if (old_page >= LOW_MEM)
 		mem_map[MAP_NR(old_page)]--;
-	*table_entry = new_page | 7;
+	*table_entry = new_page | (PAGE_DIRTY | 7);
 	invalidate();
 	copy_page(old_page,new_page);
 }	
@@ -246,6 +298,7 @@ void un_wp_page(unsigned long * table_entry)
  */
 void do_wp_page(unsigned long error_code,unsigned long address)
 {
+	tracepoint(TR_WP_PAGE,address,0);
 #if 0
 /* we cannot do this yet: the estdio library writes to code space */
 /* stupid, stupid. I really want the libc.a from GNU */
@@ -253,8 +306,7 @@ void do_wp_page(unsigned long error_code,unsigned long address)
 		do_exit(SIGSEGV);
 #endif
 	un_wp_page((unsigned long *)
-		(((address>>10) & 0xffc) + (0xfffff000 &
-		*((unsigned long *) ((address>>20) &0xffc)))));
+		(((address>>10) & 0xffc) + (0xfffff000 & *PDE(address))));
 
 }
 
@@ -262,7 +314,9 @@ void write_verify(unsigned long address)
 {
 	unsigned long page;
 
-	if (!( (page = *((unsigned long *) ((address>>20) & 0xffc)) )&1))
+	if (!( (page = *PDE(address)) &1))
+		return;
+	if (page & PAGE_PSE)	/* task 0 in the kernel map: always writable */
 		return;
 	page &= 0xfffff000;
 	page += ((address>>10) & 0xffc);
@@ -297,9 +351,9 @@ static int try_to_share(unsigned long address, struct task_struct * p)
 	unsigned long to_page;
 	unsigned long phys_addr;
 
-	from_page = to_page = ((address>>20) & 0xffc);
-	from_page += ((p->start_code>>20) & 0xffc);
-	to_page += ((current->start_code>>20) & 0xffc);
+	from_page = p->tss.cr3 + (((address+p->start_code)>>20) & 0xffc);
+	to_page = current->tss.cr3 +
+		(((address+current->start_code)>>20) & 0xffc);
 /* is there a page-directory at from? */
 	from = *(unsigned long *) from_page;
 	if (!(from & 1))
@@ -363,45 +417,206 @@ static int share_page(unsigned long address)
 	return 0;
 }
 
+/*
+ * The page table entry for 'address' in the current process, or NULL if
+ * there is no page table for it.
+ */
+unsigned long * get_pte(unsigned long address)
+{
+	unsigned long page;
+
+	page = *PDE(address);
+	if (!(page & 1) || (page & PAGE_PSE))
+		return NULL;
+	return (unsigned long *) (0xfffff000 & page) + ((address>>12) & 0x3ff);
+}
+
+/* remember that 1 block is used for header */
+static void exec_blocks(unsigned long tmp,int nr[4])
+{
+	int block,i;
+
+	block = 1 + tmp/BLOCK_SIZE;
+	for (i=0 ; i<4 ; block++,i++)
+		nr[i] = bmap(current->executable,block);
+}
+
+/* zero whatever of the page is beyond the end of the data */
+static void clear_tail(unsigned long page,unsigned long tmp)
+{
+	int i;
+
+	i = tmp + 4096 - current->end_data;
+	tmp = page + 4096;
+	while (i-- > 0) {
+		tmp--;
+		*(char *)tmp = 0;
+	}
+}
+
+/*
+ * Executables are mostly read in order, so one fault at a time means one
+ * disk round-trip per page. Instead, do_no_page() starts reading the
+ * FAULT_AROUND pages that follow the faulting one together with it, and
+ * afterwards maps all the pages around it that are already in the buffer
+ * cache without waiting for anything. The next fault thus usually finds
+ * its neighbours in memory, or at least on their way.
+ */
+#define FAULT_AROUND 16
+
+static void read_around(unsigned long address)
+{
+	unsigned long tmp, * pte;
+	int nr[4], i;
+
+	for (i=0 ; i<FAULT_AROUND ; i++, address += PAGE_SIZE) {
+		tmp = address - current->start_code;
+		if (tmp >= current->end_data)
+			return;
+		if ((pte = get_pte(address)) && *pte)
+			continue;
+		exec_blocks(tmp,nr);
+		bread_page_ahead(current->executable->i_dev,nr);
+	}
+}
+
+static void fault_around(unsigned long address)
+{
+	unsigned long start, tmp, page, * pte;
+	int nr[4], i;
+
+	page = 0;
+	start = address & ~(FAULT_AROUND*PAGE_SIZE-1);
+	for (i=0 ; i<FAULT_AROUND ; i++, start += PAGE_SIZE) {
+		if (start == address)
+			continue;
+		tmp = start - current->start_code;
+		if (tmp >= current->end_data)
+			break;
+		if (!(pte = get_pte(start)) || *pte)
+			continue;
+		if (share_page(tmp))
+			continue;
+		exec_blocks(tmp,nr);
+		if (!page && !(page = get_free_page()))
+			return;
+		if (*pte || !bread_page_cached(page,current->executable->i_dev,nr))
+			continue;
+		clear_tail(page,tmp);
+		if (!put_page(page,start))
+			break;
+		page = 0;
+	}
+	free_page(page);		/* 0 is ok - ignored */
+}
+
 void do_no_page(unsigned long error_code,unsigned long address)
 {
 	int nr[4];
 	unsigned long tmp;
 	unsigned long page;
-	int block,i;
 
+	tracepoint(TR_NO_PAGE,address,0);
 	address &= 0xfffff000;
+	page = *PDE(address);
+	if (page & 1) {
+		page &= 0xfffff000;
+		page += (address >> 10) & 0xffc;
+		tmp = *(unsigned long *) page;
+		if (tmp && !(1 & tmp)) {
+			swap_in((unsigned long *) page);
+			return;
+		}
+	}
 	tmp = address - current->start_code;
 	if (!current->executable || tmp >= current->end_data) {
 		get_empty_page(address);
 		return;
 	}
-	if (share_page(tmp))
+	if (share_page(tmp)) {
+		fault_around(address);
 		return;
+	}
 	if (!(page = get_free_page()))
 		oom();
-/* remember that 1 block is used for header */
-	block = 1 + tmp/BLOCK_SIZE;
-	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(current->executable,block);
+	exec_blocks(tmp,nr);
+	bread_page_ahead(current->executable->i_dev,nr);
+	read_around(address + PAGE_SIZE);
 	bread_page(page,current->executable->i_dev,nr);
-	i = tmp + 4096 - current->end_data;
-	tmp = page + 4096;
-	while (i-- > 0) {
-		tmp--;
-		*(char *)tmp = 0;
+	clear_tail(page,tmp);
+	if (!put_page(page,address)) {
+		free_page(page);
+		oom();
 	}
-	if (put_page(page,address))
-		return;
-	free_page(page);
-	oom();
+	fault_around(address);
+}
+
+/*
+ * paging_init() maps the physical memory above the 16Mb done by head.s,
+ * taking the page tables from the start of main memory. They become part
+ * of the kernel half of every page directory. If head.s used 4Mb pages
+ * we do the same, and need no page tables at all.
+ */
+static long paging_init(long start_mem, long end_mem)
+{
+	unsigned long * pg_table;
+	unsigned long address, global;
+	int i;
+
+	if (cpu_features & CPU_PSE) {
+		global = (cpu_features & CPU_PGE) ? PAGE_GLOBAL : 0;
+		for (address = 0x1000000 ; address < end_mem ; address += 0x400000)
+			pg_dir[address>>22] = address | global | PAGE_PSE | 7;
+		invalidate();
+		return start_mem;
+	}
+	for (address = 0x1000000 ; address < end_mem ; address += 0x400000) {
+		pg_table = (unsigned long *) start_mem;
+		start_mem += PAGE_SIZE;
+		for (i=0 ; i<1024 ; i++)
+			if (address + (i<<12) < end_mem)
+				pg_table[i] = (address + (i<<12)) | 7;
+			else
+				pg_table[i] = 0;
+		pg_dir[address>>22] = (unsigned long) pg_table | 7;
+	}
+	invalidate();
+	return start_mem;
+}
+
+/*
+ * ioremap() maps a page of device registers, like those of the APICs,
+ * at the same address in the top 1Gb, uncached. The page tables go in
+ * pg_dir, so it has to be done before the first fork() to be seen by
+ * all tasks.
+ */
+unsigned long ioremap(unsigned long phys)
+{
+	unsigned long * dir, * pg_table;
+
+	phys &= 0xfffff000;
+	if (phys < TASK_BASE+TASK_SIZE)
+		panic("ioremap: address not above user space");
+	dir = pg_dir + (phys>>22);
+	if (!(1 & *dir)) {
+		if (!(pg_table = (unsigned long *) get_free_page()))
+			panic("ioremap: out of memory");
+		*dir = (unsigned long) pg_table | 3;
+	}
+	pg_table = (unsigned long *) (0xfffff000 & *dir);
+	pg_table[(phys>>12) & 0x3ff] = phys | 0x1b;	/* PCD, PWT, r/w, p */
+	invalidate();
+	return phys;
 }
 
 void mem_init(long start_mem, long end_mem)
 {
 	int i;
 
+	start_mem = paging_init(PAGE_ALIGN(start_mem),end_mem);
 	HIGH_MEMORY = end_mem;
+	mem_map = (unsigned char *) start_mem;
+	start_mem += PAGE_ALIGN(PAGING_PAGES);
 	for (i=0 ; i<PAGING_PAGES ; i++)
 		mem_map[i] = USED;
 	i = MAP_NR(start_mem);
@@ -415,13 +630,14 @@ void calc_mem(void)
 {
 	int i,j,k,free=0;
 	long * pg_tbl;
+	unsigned long * dir = (unsigned long *) current->tss.cr3;
 
 	for(i=0 ; i<PAGING_PAGES ; i++)
 		if (!mem_map[i]) free++;
 	printk("%d pages free (of %d)\n\r",free,PAGING_PAGES);
-	for(i=2 ; i<1024 ; i++) {
-		if (1&pg_dir[i]) {
-			pg_tbl=(long *) (0xfffff000 & pg_dir[i]);
+	for(i=FIRST_USER_PGD ; i<FIRST_USER_PGD+USER_PGDS ; i++) {
+		if (1&dir[i]) {
+			pg_tbl=(long *) (0xfffff000 & dir[i]);
 			for(j=k=0 ; j<1024 ; j++)
 				if (pg_tbl[j]&1)
 					k++;
@@ -25,12 +25,14 @@ page_fault:
 	movl %cr2,%edx
 	pushl %edx
 	pushl %eax
-	testl $1,%eax
+	call lock_kernel
+	testl $1,(%esp)
 	jne 1f
 	call do_no_page
 	jmp 2f
 1:	call do_wp_page
-2:	addl $8,%esp
+2:	call unlock_kernel
+	addl $8,%esp
 	pop %fs
 	pop %es
 	pop %ds
@@ -38,3 +40,5 @@ page_fault:
 	popl %ecx
 	popl %eax
 	iret
+
+.section .note.GNU-stack,"",@progbits
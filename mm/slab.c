@@ -0,0 +1,208 @@
+/*
+ *  linux/mm/slab.c
+ */
+
+/*
+ * A small slab allocator for kernel objects that come and go often, and
+ * used to live in fixed-size tables (files, inodes, requests, timers).
+ *
+ * Every slab is one page from get_free_page(). It starts with a struct
+ * slab, followed by an array of free-list indices (one per object), and
+ * the objects themselves. As the free list is kept outside the objects,
+ * a free object stays constructed, and finding the slab of an object is
+ * just a matter of masking its address.
+ *
+ * A cache keeps its slabs on three lists: full, partial and empty. New
+ * objects come from partial slabs first, which keeps them packed so that
+ * whole pages can be given back. One empty slab is always kept around: a
+ * cache made at boot can thus give out that many objects without ever
+ * asking for memory, which is what GFP_ATOMIC users depend on.
+ *
+ * The cache descriptors themselves come from malloc(). All list handling
+ * is done with interrupts off, so caches may be used from interrupts.
+ */
+
+#include <stddef.h>
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <asm/system.h>
+
+#define BUFCTL_END 0xffff
+
+struct slab {
+	struct slab * next, * prev;
+	unsigned short inuse;
+	unsigned short free;		/* first free object, or BUFCTL_END */
+};
+
+#define slab_bufctl(slabp) ((unsigned short *) ((slabp)+1))
+
+struct kmem_cache {
+	const char * name;
+	int size;			/* object size, rounded to a long */
+	int num;			/* objects per slab */
+	int offset;			/* of the first object in a slab */
+	void (*ctor)(void *);
+	struct slab * full, * partial, * empty;
+	int slabs;
+	int active, high;		/* objects in use, and most ever */
+	unsigned long allocs;
+	struct kmem_cache * next;
+};
+
+static struct kmem_cache * cache_chain = NULL;
+
+static void slab_add(struct slab ** list, struct slab * slabp)
+{
+	slabp->prev = NULL;
+	if ((slabp->next = *list))
+		slabp->next->prev = slabp;
+	*list = slabp;
+}
+
+static void slab_del(struct slab ** list, struct slab * slabp)
+{
+	if (slabp->next)
+		slabp->next->prev = slabp->prev;
+	if (slabp->prev)
+		slabp->prev->next = slabp->next;
+	else
+		*list = slabp->next;
+}
+
+/*
+ * kmem_cache_grow() gets a new page for the cache and builds the free
+ * list of its objects. It may sleep (unless GFP_ATOMIC), so it must be
+ * called with nothing half-done.
+ */
+static struct slab * kmem_cache_grow(struct kmem_cache * cachep, int priority)
+{
+	struct slab * slabp;
+	unsigned short * ctl;
+	char * objp;
+	int i;
+
+	if (!(slabp = (struct slab *) __get_free_page(priority)))
+		return NULL;
+	ctl = slab_bufctl(slabp);
+	objp = cachep->offset + (char *) slabp;
+	for (i=0 ; i<cachep->num ; i++,objp += cachep->size) {
+		ctl[i] = i+1;
+		if (cachep->ctor)
+			cachep->ctor(objp);
+	}
+	ctl[cachep->num-1] = BUFCTL_END;
+	slabp->inuse = 0;
+	slabp->free = 0;
+	return slabp;
+}
+
+struct kmem_cache * kmem_cache_create(const char * name, int size,
+	void (*ctor)(void *))
+{
+	struct kmem_cache * cachep;
+	struct slab * slabp;
+	unsigned long flags;
+
+	size = (size+3) & ~3;
+	if (size <= 0 || size > PAGE_SIZE/2)
+		panic("kmem_cache_create: bad object size");
+	cachep = (struct kmem_cache *) malloc(sizeof(struct kmem_cache));
+	cachep->name = name;
+	cachep->size = size;
+	cachep->num = (PAGE_SIZE - sizeof(struct slab) - 3) /
+		(size + sizeof(unsigned short));
+	cachep->offset = (sizeof(struct slab) +
+		cachep->num*sizeof(unsigned short) + 3) & ~3;
+	cachep->ctor = ctor;
+	cachep->full = cachep->partial = cachep->empty = NULL;
+	cachep->slabs = cachep->active = cachep->high = 0;
+	cachep->allocs = 0;
+	if (!(slabp = kmem_cache_grow(cachep,GFP_KERNEL)))
+		panic("kmem_cache_create: out of memory");
+	save_flags(flags);
+	cli();
+	slab_add(&cachep->empty,slabp);
+	cachep->slabs++;
+	cachep->next = cache_chain;
+	cache_chain = cachep;
+	restore_flags(flags);
+	return cachep;
+}
+
+void * kmem_cache_alloc(struct kmem_cache * cachep, int priority)
+{
+	struct slab * slabp;
+	unsigned long flags;
+	char * objp;
+
+	save_flags(flags);
+	cli();
+	while (!(slabp = cachep->partial)) {
+		if ((slabp = cachep->empty)) {
+			slab_del(&cachep->empty,slabp);
+			slab_add(&cachep->partial,slabp);
+			break;
+		}
+		if (!(slabp = kmem_cache_grow(cachep,priority))) {
+			restore_flags(flags);
+			return NULL;
+		}
+		slab_add(&cachep->empty,slabp);
+		cachep->slabs++;
+	}
+	objp = cachep->offset + slabp->free*cachep->size + (char *) slabp;
+	slabp->free = slab_bufctl(slabp)[slabp->free];
+	if (++slabp->inuse == cachep->num) {
+		slab_del(&cachep->partial,slabp);
+		slab_add(&cachep->full,slabp);
+	}
+	cachep->allocs++;
+	if (++cachep->active > cachep->high)
+		cachep->high = cachep->active;
+	restore_flags(flags);
+	return objp;
+}
+
+void kmem_cache_free(struct kmem_cache * cachep, void * objp)
+{
+	struct slab * slabp;
+	unsigned long flags;
+	int nr;
+
+	slabp = (struct slab *) (0xfffff000 & (unsigned long) objp);
+	nr = (char *) objp - cachep->offset - (char *) slabp;
+	if (nr < 0 || nr % cachep->size || (nr /= cachep->size) >= cachep->num)
+		panic("kmem_cache_free: bad object");
+	save_flags(flags);
+	cli();
+	if (slabp->inuse == cachep->num) {
+		slab_del(&cachep->full,slabp);
+		slab_add(&cachep->partial,slabp);
+	}
+	slab_bufctl(slabp)[nr] = slabp->free;
+	slabp->free = nr;
+	cachep->active--;
+	if (!--slabp->inuse) {
+		slab_del(&cachep->partial,slabp);
+		if (cachep->empty) {
+			cachep->slabs--;
+			free_page((unsigned long) slabp);
+		} else
+			slab_add(&cachep->empty,slabp);
+	}
+	restore_flags(flags);
+}
+
+void kmem_cache_stats(void)
+{
+	struct kmem_cache * cachep;
+
+	printk("cache     size  active (max)  objs slabs  allocs\n\r");
+	for (cachep = cache_chain ; cachep ; cachep = cachep->next)
+		printk("%-8s %5d %7d %5d %5d %5d %7d\n\r",
+			cachep->name,cachep->size,cachep->active,cachep->high,
+			cachep->slabs*cachep->num,cachep->slabs,cachep->allocs);
+}
@@ -0,0 +1,332 @@
+/*
+ *  linux/mm/swap.c
+ */
+
+/*
+ * swap.c contains the code to page user memory out to a swap area and
+ * back in again. The swap area is either a block device or a regular
+ * file on a minix filesystem: its first page is the bitmap of usable
+ * pages (with "SWAP-SPACE" in the last 10 bytes, as made by mkswap),
+ * every other page is a swap slot.
+ *
+ * All swap I/O goes through the buffer cache, just as demand-loading
+ * from executables does. That way we get read-ahead, write-behind and
+ * the buffer locking for free, and a page that is faulted back in soon
+ * after being swapped out doesn't even have to touch the disk.
+ *
+ * Page replacement is a simple clock: swap_out() sweeps the user page
+ * tables of all processes in order, and a page that has been accessed
+ * since the hand last passed it gets a second chance.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/kernel.h>
+#include <asm/system.h>
+
+void do_exit(long code);
+
+#define SWAP_BITS (4096<<3)
+
+/*
+ * When a page is swapped in, the in-use slots following it are read
+ * ahead: the clock writes neighbouring pages to neighbouring slots, so
+ * they are likely to be wanted next.
+ */
+#define SWAP_CLUSTER 8
+
+#define bitop(name,op) \
+static inline int name(char * addr,unsigned int nr) \
+{ \
+int __res; \
+__asm__ __volatile__("bt" op " %1,%2; adcl $0,%0" \
+	:"=g" (__res) \
+	:"r" (nr),"m" (*(addr)),"0" (0) \
+	:"memory"); \
+return __res; \
+}
+
+bitop(bit,"")
+bitop(setbit,"s")
+bitop(clrbit,"r")
+
+/* a set bit means the slot is free */
+static char * swap_bitmap = NULL;
+static int swap_dev = 0;
+static struct m_inode * swap_file = NULL;
+static int swap_hint = 1;
+
+/*
+ * swap_blocks() gets the four blocks of swap slot 'nr'. They are
+ * consecutive on a swap partition, but have to be looked up for a
+ * swap file. Returns 0 if the slot has a hole in it.
+ */
+static int swap_blocks(int nr,int b[4])
+{
+	int i;
+
+	for (i=0 ; i<4 ; i++) {
+		b[i] = nr*(PAGE_SIZE/BLOCK_SIZE) + i;
+		if (swap_file && !(b[i] = bmap(swap_file,b[i])))
+			return 0;
+	}
+	return 1;
+}
+
+static int get_swap_page(void)
+{
+	int nr;
+
+	if (!swap_bitmap)
+		return 0;
+	nr = swap_hint;
+	do {
+		if (clrbit(swap_bitmap,nr)) {
+			swap_hint = nr+1;
+			if (swap_hint >= SWAP_BITS)
+				swap_hint = 1;
+			return nr;
+		}
+		if (++nr >= SWAP_BITS)
+			nr = 1;
+	} while (nr != swap_hint);
+	return 0;
+}
+
+void swap_free(int nr)
+{
+	if (!nr)
+		return;
+	if (swap_bitmap && nr < SWAP_BITS && !setbit(swap_bitmap,nr))
+		return;
+	printk("swap_free: swap-space bitmap bad\n\r");
+}
+
+void read_swap_page(int nr, char * buffer)
+{
+	int b[4];
+
+	if (!swap_bitmap || !swap_blocks(nr,b))
+		panic("read_swap_page: bad swap slot");
+	bread_page((unsigned long) buffer,swap_dev,b);
+}
+
+void swap_in(unsigned long * table_ptr)
+{
+	unsigned long entry, page;
+	int nr, i, b[4];
+
+	entry = *table_ptr;
+	nr = entry >> 1;
+	if (!swap_bitmap || !nr || nr >= SWAP_BITS || bit(swap_bitmap,nr)) {
+		printk("swap_in: bad swap entry %08x\n\r",entry);
+		do_exit(SIGSEGV);
+	}
+	if (!(page = get_free_page())) {
+		printk("out of memory\n\r");
+		do_exit(SIGSEGV);
+	}
+	read_swap_page(nr,(char *) page);
+	if (*table_ptr != entry) {
+		free_page(page);
+		return;
+	}
+	*table_ptr = page | (PAGE_DIRTY | 7);
+	swap_free(nr);
+	for (i=1 ; i<SWAP_CLUSTER && ++nr<SWAP_BITS ; i++) {
+		if (bit(swap_bitmap,nr))
+			continue;
+		if (swap_blocks(nr,b))
+			bread_page_ahead(swap_dev,b);
+	}
+}
+
+/*
+ * try_to_swap_out() looks at one page table entry. Pages that have been
+ * used since we last came by just lose their accessed bit. Clean pages
+ * are simply dropped - do_no_page() gets them back from the executable,
+ * or as zero pages. Dirty unshared pages are copied to a swap slot.
+ */
+static int try_to_swap_out(unsigned long * table_ptr)
+{
+	struct buffer_head * bh[4];
+	unsigned long entry, page, table;
+	int nr, i, b[4];
+
+	entry = *table_ptr;
+	if (!(PAGE_PRESENT & entry))
+		return 0;
+	page = entry & 0xfffff000;
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
+		return 0;
+	if (PAGE_ACCESSED & entry) {
+		*table_ptr = entry & ~PAGE_ACCESSED;
+		invalidate();
+		return 0;
+	}
+	if (!(PAGE_DIRTY & entry)) {
+		*table_ptr = 0;
+		invalidate();
+		free_page(page);
+		return 1;
+	}
+	if (mem_map[MAP_NR(page)] != 1)
+		return 0;
+	if (!(nr = get_swap_page()))
+		return 0;
+/*
+ * Finding the blocks and buffers may sleep, and the owner may touch or
+ * free the page meanwhile. Keep a reference to the page table so that it
+ * can't be reused under us, and re-check everything before committing.
+ */
+	table = 0xfffff000 & (unsigned long) table_ptr;
+	mem_map[MAP_NR(table)]++;
+	for (i=0 ; i<4 ; i++)
+		bh[i] = NULL;
+	if (swap_blocks(nr,b))
+		for (i=0 ; i<4 ; i++)
+			bh[i] = getblk(swap_dev,b[i]);
+	for (i=0 ; i<4 ; i++)
+		if (!bh[i] || bh[i]->b_lock)
+			break;
+	if (i<4 || *table_ptr != entry || mem_map[MAP_NR(page)] != 1) {
+		for (i=0 ; i<4 ; i++)
+			brelse(bh[i]);
+		swap_free(nr);
+		free_page(table);
+		return 0;
+	}
+	for (i=0 ; i<4 ; i++) {
+		memcpy(bh[i]->b_data,(char *) page + i*BLOCK_SIZE,BLOCK_SIZE);
+		bh[i]->b_uptodate = 1;
+		bh[i]->b_dirt = 1;
+	}
+	*table_ptr = nr << 1;
+	invalidate();
+	free_page(page);
+	free_page(table);
+	for (i=0 ; i<4 ; i++)
+		ll_rw_block(WRITE,bh[i]);
+	for (i=0 ; i<4 ; i++)
+		brelse(bh[i]);
+	return 1;
+}
+
+/*
+ * swap_out() is called by get_free_page() when memory runs out. It moves
+ * the clock hand over the user page tables until a page has been freed.
+ * Two full sweeps are enough: the first one clears all accessed bits.
+ * Task 0 lives in kernel memory and is never looked at.
+ */
+int swap_out(void)
+{
+	static int task_nr = 1;
+	static int dir_entry = FIRST_USER_PGD;
+	static int page_entry = -1;
+	int counter = 2*NR_TASKS*USER_PGDS*1024;
+	unsigned long pg_table;
+	struct task_struct * p;
+
+	while (counter > 0) {
+		if (++page_entry >= 1024) {
+			page_entry = 0;
+			if (++dir_entry >= FIRST_USER_PGD+USER_PGDS) {
+				dir_entry = FIRST_USER_PGD;
+				if (++task_nr >= NR_TASKS)
+					task_nr = 1;
+			}
+		}
+		p = task[task_nr];
+		if (!p || p->tss.cr3 == (unsigned long) pg_dir) {
+			counter -= (FIRST_USER_PGD+USER_PGDS-dir_entry)*1024
+				- page_entry;
+			dir_entry = FIRST_USER_PGD+USER_PGDS-1;
+			page_entry = 1023;
+			continue;
+		}
+		pg_table = ((unsigned long *) p->tss.cr3)[dir_entry];
+		if (!(pg_table & 1)) {
+			counter -= 1024 - page_entry;
+			page_entry = 1023;
+			continue;
+		}
+		counter--;
+		pg_table &= 0xfffff000;
+		if (try_to_swap_out(page_entry + (unsigned long *) pg_table))
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * sys_swapon() enables swapping to a block device or a regular file.
+ * Slots of a swap file that fall in a hole or beyond the end of the file
+ * are not used.
+ */
+int sys_swapon(const char * specialfile)
+{
+	struct m_inode * inode;
+	char * bitmap;
+	int i, dev, pages, b[4];
+
+	if (!suser())
+		return -EPERM;
+	if (swap_bitmap)
+		return -EBUSY;
+	if (!(inode = namei(specialfile)))
+		return -ENOENT;
+	if (S_ISBLK(inode->i_mode)) {
+		dev = inode->i_zone[0];
+		iput(inode);
+		inode = NULL;
+	} else if (S_ISREG(inode->i_mode))
+		dev = inode->i_dev;
+	else {
+		iput(inode);
+		return -ENOTBLK;
+	}
+	if (!(bitmap = (char *) get_free_page())) {
+		iput(inode);
+		return -ENOMEM;
+	}
+	swap_dev = dev;
+	swap_file = inode;
+	if (!swap_blocks(0,b))
+		goto bad_swap;
+	bread_page((unsigned long) bitmap,dev,b);
+	if (strncmp("SWAP-SPACE",bitmap+PAGE_SIZE-10,10)) {
+		printk("Unable to find swap-space signature\n\r");
+		goto bad_swap;
+	}
+	memset(bitmap+PAGE_SIZE-10,0,10);
+	clrbit(bitmap,0);
+	pages = 0;
+	for (i=1 ; i<SWAP_BITS ; i++) {
+		if (!bit(bitmap,i))
+			continue;
+		if ((inode && (i+1)*PAGE_SIZE > inode->i_size) ||
+		    !swap_blocks(i,b))
+			clrbit(bitmap,i);
+		else
+			pages++;
+	}
+	if (!pages) {
+		printk("Empty swap-file\n\r");
+		goto bad_swap;
+	}
+	swap_hint = 1;
+	swap_bitmap = bitmap;
+	printk("Adding swap: %d pages (%dkB) swap-space\n\r",pages,pages*4);
+	return 0;
+bad_swap:
+	swap_dev = 0;
+	swap_file = NULL;
+	iput(inode);
+	free_page((unsigned long) bitmap);
+	return -EINVAL;
+}
@@ -8,10 +8,12 @@ setup=$2
 system=$3
 IMAGE=$4
 root_dev=$5
+sched_class=$6
 
 # Set the biggest sys_size
-# Changes from 0x20000 to 0x30000 by tigercn to avoid oversized code.
-SYS_SIZE=$((0x3000*16))
+# Changes from 0x20000 to 0x30000 by tigercn to avoid oversized code,
+# and to 0x40000 for SMP.
+SYS_SIZE=$((0x4000*16))
 
 # set the default "device" file for root image file
 if [ -z "$root_dev" ]; then
@@ -38,3 +40,8 @@ dd if=$system seek=5 bs=512 count=$((2888-1-4)) of=$IMAGE 2>&1 >/dev/null
 
 # Set "device" for the root image file
 echo -ne "\x$DEFAULT_MINOR_ROOT\x$DEFAULT_MAJOR_ROOT" | dd ibs=1 obs=1 count=2 seek=508 of=$IMAGE conv=notrunc  2>&1 >/dev/null
+
+# Set the scheduling class, if one was given
+if [ -n "$sched_class" ]; then
+	echo -ne "\x0$sched_class\x00" | dd ibs=1 obs=1 count=2 seek=506 of=$IMAGE conv=notrunc  2>&1 >/dev/null
+fi
@@ -0,0 +1,134 @@
+/*
+ *  tools/cachetest.c
+ */
+
+/*
+ * cachetest runs in the guest. It measures how fast read() copies out
+ * of the buffer cache, which is mostly the kernel touching buffer and
+ * user pages: what the 4Mb kernel pages are for.
+ *
+ *	cachetest [file [kbytes [passes]]]
+ *
+ * It reads the first 'kbytes' (256 by default) of 'file' (/bin/sh, or
+ * a block device such as /dev/hd1) once to get it in the cache, then
+ * 'passes' (100) more times in blocks of BLOCK, and prints the MB/s of
+ * those. 'kbytes' has to fit in the buffer cache, or it measures the
+ * disk. Run it on a kernel with and without PSE to compare.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+
+#define BLOCK	4096
+
+_syscall3(int,read,int,fd,char *,buf,off_t,count)
+_syscall3(int,lseek,int,fd,off_t,offset,int,origin)
+_syscall2(int,gettimeofday,struct timeval *,tp,struct timezone *,tz)
+
+static char buf[BLOCK];
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char b[12];
+	int i = sizeof b;
+
+	b[--i] = 0;
+	do {
+		b[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(b+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv,0);
+	return tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+/* reads up to 'bytes' from the start of 'fd', and returns how much */
+static unsigned long read_pass(int fd, unsigned long bytes)
+{
+	unsigned long done = 0;
+	int n;
+
+	if (lseek(fd,0,SEEK_SET) < 0)
+		return 0;
+	while (done < bytes) {
+		n = bytes - done < BLOCK ? bytes - done : BLOCK;
+		if ((n = read(fd,buf,n)) <= 0)
+			break;
+		done += n;
+	}
+	return done;
+}
+
+int main(int argc, char ** argv)
+{
+	char * name = argc > 1 ? argv[1] : "/bin/sh";
+	unsigned long bytes = (argc > 2 ? atoul(argv[2]) : 256) * 1024;
+	unsigned long passes = argc > 3 ? atoul(argv[3]) : 100;
+	unsigned long size, kb = 0, i, start, time, kbps;
+	int fd;
+
+	if ((fd = open(name,O_RDONLY)) < 0) {
+		put("cachetest: can't open ");
+		put(name);
+		put("\n");
+		return 1;
+	}
+	if (!(size = read_pass(fd,bytes))) {
+		put("cachetest: nothing to read\n");
+		return 1;
+	}
+	start = usecs();
+	for (i = 0 ; i < passes ; i++) {
+		if (read_pass(fd,bytes) != size) {
+			put("cachetest: short read\n");
+			return 1;
+		}
+		kb += size >> 10;
+	}
+	time = (usecs() - start) / 1000;
+	put_num(passes);
+	put(" x ");
+	put_num(size);
+	put(" bytes in ");
+	put_num(time);
+	put(" ms, ");
+	if (time) {
+		kbps = kb / time * 1000 + kb % time * 1000 / time;
+		put_num(kbps / 1024);
+		put(".");
+		put_num(kbps % 1024 * 10 / 1024);
+	} else
+		put("-");
+	put(" MB/s\n");
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ *  tools/latencytest.c
+ */
+
+/*
+ * latencytest runs in the guest. It measures how late a sleeping task
+ * gets the cpu back when others want it all:
+ *
+ *	latencytest [hogs [samples [ms]]]
+ *
+ * It starts 'hogs' (4 by default) processes that only spin, then sleeps
+ * 'samples' (200) times for 'ms' (10) milliseconds with nanosleep(), and
+ * takes the time each sleep really took with clock_gettime(). It prints
+ * the least, mean and most it overslept, in microseconds.
+ *
+ * nanosleep() rounds up to whole ticks plus one, so even with no hogs
+ * it oversleeps by up to two ticks: run it with 0 hogs first to see
+ * that. Run it on an image built with SCHED_CLASS=0 and one with 1 to
+ * compare the counter and the fair scheduler.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#define MAX_HOGS	32
+
+static inline _syscall0(int,fork)
+_syscall2(int,kill,pid_t,pid,int,sig)
+_syscall2(int,clock_gettime,int,clock_id,struct timespec *,tp)
+_syscall2(int,nanosleep,const struct timespec *,rqtp,struct timespec *,rmtp)
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char b[12];
+	int i = sizeof b;
+
+	b[--i] = 0;
+	do {
+		b[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(b+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned long hogs = argc > 1 ? atoul(argv[1]) : 4;
+	unsigned long samples = argc > 2 ? atoul(argv[2]) : 200;
+	unsigned long ms = argc > 3 ? atoul(argv[3]) : 10;
+	unsigned long i, n, start, late, least = ~0UL, most = 0, sum = 0;
+	pid_t pid[MAX_HOGS];
+	struct timespec ts;
+	int status;
+
+	if (hogs > MAX_HOGS || !samples)
+		return 1;
+	for (i = 0 ; i < hogs ; i++)
+		if (!(pid[i] = fork()))
+			for (;;)
+				/* nothing */;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = ms % 1000 * 1000000;
+	for (n = 0 ; n < samples ; n++) {
+		start = usecs();
+		if (nanosleep(&ts,0) < 0)
+			break;
+		late = usecs() - start;
+		late = late > ms*1000 ? late - ms*1000 : 0;
+		if (late < least)
+			least = late;
+		if (late > most)
+			most = late;
+		sum += late;
+	}
+	for (i = 0 ; i < hogs ; i++)
+		if (pid[i] > 0)
+			kill(pid[i],SIGKILL);
+	while (wait(&status) > 0)
+		/* nothing */;
+	if (!n)
+		return 1;
+	put_num(hogs);
+	put(" hogs, ");
+	put_num(n);
+	put(" sleeps of ");
+	put_num(ms);
+	put(" ms, late by min ");
+	put_num(least);
+	put(" mean ");
+	put_num(sum / n);
+	put(" max ");
+	put_num(most);
+	put(" us\n");
+	return 0;
+}
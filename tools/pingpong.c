@@ -0,0 +1,107 @@
+/*
+ *  tools/pingpong.c
+ */
+
+/*
+ * pingpong runs in the guest. It measures what a context switch costs:
+ *
+ *	pingpong [round trips]
+ *
+ * Two processes pass a byte back and forth through two pipes, each
+ * blocking in read() until the other has written, so every round trip
+ * is two switches. It prints the time per switch over 'round trips'
+ * (10000 by default), which includes a read() and a write() each, so
+ * compare runs rather than reading it as the bare switch.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/time.h>
+
+static inline _syscall0(int,fork)
+_syscall1(int,pipe,int *,fildes)
+_syscall3(int,read,int,fd,char *,buf,off_t,count)
+_syscall2(int,gettimeofday,struct timeval *,tp,struct timezone *,tz)
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char b[12];
+	int i = sizeof b;
+
+	b[--i] = 0;
+	do {
+		b[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(b+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv,0);
+	return tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned long trips = argc > 1 ? atoul(argv[1]) : 10000;
+	unsigned long i, start, time, per;
+	int ping[2], pong[2], status;
+	char c = 0;
+
+	if (!trips || pipe(ping) < 0 || pipe(pong) < 0)
+		return 1;
+	if (!fork()) {
+		close(ping[1]);
+		close(pong[0]);
+		while (read(ping[0],&c,1) == 1)
+			if (write(pong[1],&c,1) != 1)
+				_exit(1);
+		_exit(0);
+	}
+	close(ping[0]);
+	close(pong[1]);
+	start = usecs();
+	for (i = 0 ; i < trips ; i++)
+		if (write(ping[1],&c,1) != 1 || read(pong[0],&c,1) != 1) {
+			put("pingpong: the other side went away\n");
+			return 1;
+		}
+	time = usecs() - start;
+	close(ping[1]);
+	wait(&status);
+	per = time / (2*trips);
+	put_num(trips);
+	put(" round trips in ");
+	put_num(time / 1000);
+	put(" ms, ");
+	put_num(per);
+	put(".");
+	put_num(time % (2*trips) * 10 / (2*trips));
+	put(" us per switch\n");
+	return 0;
+}
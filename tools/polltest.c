@@ -0,0 +1,265 @@
+/*
+ *  tools/polltest.c
+ */
+
+/*
+ * polltest runs in the guest. It measures relaying data from several
+ * pipes into one, three ways:
+ *
+ *	poll	one relay process waiting in poll() on all the pipes
+ *	select	the same with select()
+ *	fork	one relay process per pipe, each blocking in read()
+ *
+ *	polltest [bytes]
+ *
+ * NR_SOURCES writer processes each put their share of 'bytes' (1Mb by
+ * default) into a pipe of their own, and polltest counts what comes out
+ * of the relay's pipe until the last relay closes it. Each byte a writer
+ * sends is its number, so bytes that are lost or mixed up between pipes
+ * show up in the counts. polltest exits 1 if any count is wrong.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+
+#define NR_SOURCES	4
+#define CHUNK		512
+
+static inline _syscall0(int,fork)
+_syscall1(int,pipe,int *,fildes)
+_syscall3(int,read,int,fd,char *,buf,off_t,count)
+_syscall3(int,poll,struct pollfd *,fds,unsigned int,nfds,int,timeout)
+_syscall2(int,gettimeofday,struct timeval *,tp,struct timezone *,tz)
+
+static int src[NR_SOURCES][2], dst[2];
+static char buf[CHUNK];
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char b[12];
+	int i = sizeof b;
+
+	b[--i] = 0;
+	do {
+		b[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(b+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv,0);
+	return tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+/* close all the pipe ends but the one 'keep' */
+static void close_all_but(int keep)
+{
+	int i;
+
+	for (i = 0 ; i < NR_SOURCES ; i++) {
+		if (src[i][0] != keep)
+			close(src[i][0]);
+		if (src[i][1] != keep)
+			close(src[i][1]);
+	}
+	if (dst[0] != keep)
+		close(dst[0]);
+	if (dst[1] != keep)
+		close(dst[1]);
+}
+
+static void writer(int nr, unsigned long bytes)
+{
+	int i, n;
+
+	close_all_but(src[nr][1]);
+	for (i = 0 ; i < CHUNK ; i++)
+		buf[i] = nr;
+	while (bytes) {
+		n = bytes < CHUNK ? bytes : CHUNK;
+		if (write(src[nr][1],buf,n) != n)
+			_exit(1);
+		bytes -= n;
+	}
+	_exit(0);
+}
+
+/* one read's worth from 'fd' to the relay's pipe: 0 at end of file */
+static int copy_out(int fd)
+{
+	int n, m, w;
+
+	if ((n = read(fd,buf,CHUNK)) <= 0)
+		return n;
+	for (m = 0 ; m < n ; m += w)
+		if ((w = write(dst[1],buf+m,n-m)) <= 0)
+			_exit(1);
+	return n;
+}
+
+static void poll_relay(void)
+{
+	struct pollfd fds[NR_SOURCES];
+	int i, nr = NR_SOURCES;
+
+	for (i = 0 ; i < NR_SOURCES ; i++) {
+		close(src[i][1]);
+		fds[i].fd = src[i][0];
+		fds[i].events = POLLIN;
+	}
+	close(dst[0]);
+	while (nr) {
+		if (poll(fds,nr,-1) < 0)
+			_exit(1);
+		for (i = 0 ; i < nr ; i++)
+			if (fds[i].revents && copy_out(fds[i].fd) <= 0) {
+				close(fds[i].fd);
+				fds[i--] = fds[--nr];
+			}
+	}
+	_exit(0);
+}
+
+static void select_relay(void)
+{
+	fd_set open_set, set;
+	int i, n = 0, nr = NR_SOURCES;
+
+	FD_ZERO(&open_set);
+	for (i = 0 ; i < NR_SOURCES ; i++) {
+		close(src[i][1]);
+		FD_SET(src[i][0],&open_set);
+		if (src[i][0] >= n)
+			n = src[i][0]+1;
+	}
+	close(dst[0]);
+	while (nr) {
+		set = open_set;
+		if (select(n,&set,0,0,0) < 0)
+			_exit(1);
+		for (i = 0 ; i < n ; i++)
+			if (FD_ISSET(i,&set) && copy_out(i) <= 0) {
+				close(i);
+				FD_CLR(i,&open_set);
+				nr--;
+			}
+	}
+	_exit(0);
+}
+
+static void fork_relay(int nr)
+{
+	int i;
+
+	for (i = 0 ; i < NR_SOURCES ; i++) {
+		if (i != nr)
+			close(src[i][0]);
+		close(src[i][1]);
+	}
+	close(dst[0]);
+	while (copy_out(src[nr][0]) > 0)
+		/* nothing */;
+	_exit(0);
+}
+
+/* runs one way of relaying, and returns 0 if all the data came through */
+static int run(const char * name, int mode, unsigned long bytes)
+{
+	unsigned long count[NR_SOURCES], total = 0, start, time;
+	int i, n, status, err = 0;
+
+	for (i = 0 ; i < NR_SOURCES ; i++) {
+		count[i] = 0;
+		if (pipe(src[i]) < 0)
+			return 1;
+	}
+	if (pipe(dst) < 0)
+		return 1;
+	start = usecs();
+	for (i = 0 ; i < NR_SOURCES ; i++)
+		if (!fork())
+			writer(i,bytes/NR_SOURCES);
+	if (mode == 2) {
+		for (i = 0 ; i < NR_SOURCES ; i++)
+			if (!fork())
+				fork_relay(i);
+	} else if (!fork()) {
+		if (mode)
+			select_relay();
+		poll_relay();
+	}
+	for (i = 0 ; i < NR_SOURCES ; i++) {
+		close(src[i][0]);
+		close(src[i][1]);
+	}
+	close(dst[1]);
+	while ((n = read(dst[0],buf,CHUNK)) > 0)
+		for (i = 0 ; i < n ; i++) {
+			if (buf[i] < 0 || buf[i] >= NR_SOURCES) {
+				err = 1;
+				continue;
+			}
+			count[(int) buf[i]]++;
+			total++;
+		}
+	time = (usecs() - start) / 1000;
+	close(dst[0]);
+	while (wait(&status) > 0)
+		if (status)
+			err = 1;
+	for (i = 0 ; i < NR_SOURCES ; i++)
+		if (count[i] != bytes/NR_SOURCES)
+			err = 1;
+	put(name);
+	put(": ");
+	put_num(total);
+	put(" bytes in ");
+	put_num(time);
+	put(" ms, ");
+	if (time)
+		put_num(total / time * 1000 + total % time * 1000 / time);
+	else
+		put("-");
+	put(err ? " bytes/s, WRONG\n" : " bytes/s\n");
+	return err;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned long bytes = argc > 1 ? atoul(argv[1]) : 1024*1024;
+	int err = 0;
+
+	bytes -= bytes % NR_SOURCES;
+	err |= run("poll",0,bytes);
+	err |= run("select",1,bytes);
+	err |= run("fork",2,bytes);
+	return err;
+}
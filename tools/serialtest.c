@@ -0,0 +1,144 @@
+/*
+ *  tools/serialtest.c
+ */
+
+/*
+ * serialtest runs in the guest. It checks that data comes back unchanged
+ * from a serial line at 115200, and how fast:
+ *
+ *	serialtest [device [bytes]]
+ *
+ * The device is /dev/tty1 (COM1) if none is given. The peer has to echo
+ * everything back: a loopback plug, or a QEMU serial pipe looped on the
+ * host, eg.
+ *
+ *	mkfifo /tmp/com1.in /tmp/com1.out
+ *	cat /tmp/com1.out > /tmp/com1.in &
+ *	qemu-system-i386 ... -serial pipe:/tmp/com1
+ *
+ * It sets the line raw, 8N1, with a one second read timeout, writes
+ * 'bytes' (64k by default) in blocks of BLOCK and reads each block back
+ * before the next one. It exits 1 on a lost or changed byte, or if
+ * TCSETS turns down B115200.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/time.h>
+
+#define BLOCK	256
+
+#define __NR_sys_ioctl __NR_ioctl
+static _syscall3(int,sys_ioctl,int,fd,int,cmd,long,arg)
+_syscall3(int,read,int,fd,char *,buf,off_t,count)
+_syscall2(int,gettimeofday,struct timeval *,tp,struct timezone *,tz)
+
+static char out[BLOCK], in[BLOCK];
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char buf[12];
+	int i = sizeof buf;
+
+	buf[--i] = 0;
+	do {
+		buf[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(buf+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv,0);
+	return tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+int main(int argc, char ** argv)
+{
+	char * dev = argc > 1 ? argv[1] : "/dev/tty1";
+	unsigned long bytes = argc > 2 ? atoul(argv[2]) : 65536;
+	unsigned long done = 0, start, time;
+	struct termios t;
+	int fd, i, n, got;
+
+	if ((fd = open(dev,O_RDWR)) < 0) {
+		put("serialtest: can't open ");
+		put(dev);
+		put("\n");
+		return 1;
+	}
+	sys_ioctl(fd,TCGETS,(long) &t);
+	t.c_iflag = 0;
+	t.c_oflag = 0;
+	t.c_lflag = 0;
+	t.c_cflag = B115200 | CS8 | CREAD | CLOCAL;
+	t.c_cc[VMIN] = 0;
+	t.c_cc[VTIME] = 10;
+	if (sys_ioctl(fd,TCSETS,(long) &t) < 0) {
+		put("serialtest: B115200 refused\n");
+		return 1;
+	}
+	for (i = 0 ; i < BLOCK ; i++)
+		out[i] = i;
+	start = usecs();
+	while (done < bytes) {
+		n = bytes - done < BLOCK ? bytes - done : BLOCK;
+		if (write(fd,out,n) != n) {
+			put("serialtest: write failed\n");
+			return 1;
+		}
+		for (got = 0 ; got < n ; got += i)
+			if ((i = read(fd,in+got,n-got)) <= 0) {
+				put("serialtest: timed out after ");
+				put_num(done+got);
+				put(" bytes\n");
+				return 1;
+			}
+		for (i = 0 ; i < n ; i++)
+			if (in[i] != out[i]) {
+				put("serialtest: bad byte at ");
+				put_num(done+i);
+				put("\n");
+				return 1;
+			}
+		done += n;
+	}
+	time = (usecs() - start) / 1000;
+	put_num(done);
+	put(" bytes in ");
+	put_num(time);
+	put(" ms, ");
+	if (time)
+		put_num(done / time * 1000 + done % time * 1000 / time);
+	else
+		put("-");
+	put(" bytes/s\n");
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ *  tools/smptest.c
+ */
+
+/*
+ * smptest runs in the guest. It measures how a fixed amount of cpu-bound
+ * work spreads over the cpus, the way a parallel make would:
+ *
+ *	smptest [max jobs [units]]
+ *
+ * The work is 'units' (64 by default) units of summing and stirring a
+ * buffer of the job's own, so each job takes its pages on a fork like a
+ * compiler does. It is done by 1 job, then 2, 4 and so on up to 'max
+ * jobs' (4), each job with its share of the units, and for each it
+ * prints the wall time and how much faster that is than one job.
+ *
+ * Run it under -smp 1, 2 and 4. With one cpu more jobs only cost a
+ * little; with n of them up to n jobs should get near n times faster,
+ * and what is missing is time spent on the kernel lock.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/time.h>
+
+#define BUF_SIZE	16384
+#define PASSES		64	/* over the buffer, per unit */
+
+static inline _syscall0(int,fork)
+_syscall2(int,gettimeofday,struct timeval *,tp,struct timezone *,tz)
+
+static unsigned long buf[BUF_SIZE/sizeof(unsigned long)];
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char b[12];
+	int i = sizeof b;
+
+	b[--i] = 0;
+	do {
+		b[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(b+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv,0);
+	return tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+/* one unit of work: the sum is returned so that it isn't optimized out */
+static unsigned long unit(unsigned long seed)
+{
+	unsigned long sum = seed;
+	int i, j;
+
+	for (i = 0 ; i < PASSES ; i++)
+		for (j = 0 ; j < BUF_SIZE/sizeof(unsigned long) ; j++) {
+			sum = sum * 31 + buf[j];
+			buf[j] = sum ^ (sum >> 7);
+		}
+	return sum;
+}
+
+static void job(unsigned long units)
+{
+	unsigned long sum = 0;
+
+	while (units--)
+		sum = unit(sum);
+	_exit(sum == 1);	/* as good as never */
+}
+
+/* the work done by 'jobs' jobs: the wall time in ms (at least 1), 0 on
+ * an error */
+static unsigned long run(unsigned long jobs, unsigned long units)
+{
+	unsigned long i, start, time;
+	int status, err = 0;
+
+	start = usecs();
+	for (i = 0 ; i < jobs ; i++) {
+		switch (fork()) {
+			case -1:
+				err = 1;
+				break;
+			case 0:
+				job(units/jobs + (i < units%jobs));
+		}
+	}
+	while (wait(&status) > 0)
+		if (status)
+			err = 1;
+	time = (usecs() - start) / 1000;
+	if (err)
+		return 0;
+	return time ? time : 1;
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned long max = argc > 1 ? atoul(argv[1]) : 4;
+	unsigned long units = argc > 2 ? atoul(argv[2]) : 64;
+	unsigned long jobs, time, one = 0;
+
+	if (!max || !units)
+		return 1;
+	for (jobs = 1 ; jobs <= max ; jobs *= 2) {
+		if (!(time = run(jobs,units))) {
+			put("smptest: a job failed\n");
+			return 1;
+		}
+		if (jobs == 1)
+			one = time;
+		put_num(jobs);
+		put(jobs == 1 ? " job:  " : " jobs: ");
+		put_num(time);
+		put(" ms, ");
+		put_num(one / time);
+		put(".");
+		put_num(one % time * 10 / time);
+		put(" times one job\n");
+	}
+	return 0;
+}
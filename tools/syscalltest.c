@@ -0,0 +1,111 @@
+/*
+ *  tools/syscalltest.c
+ */
+
+/*
+ * syscalltest runs in the guest. It measures the round trip of a system
+ * call that does next to nothing:
+ *
+ *	syscalltest [calls]
+ *
+ * It calls getpid() 'calls' times (100000 by default) through
+ * __syscall_vector, which is sysenter on a cpu that has it (see
+ * lib/syscall.c), and then as many times with int $0x80, and prints
+ * the time per call of each.
+ *
+ * Build it with this tree's include/ and link it with lib/lib.a. The
+ * system calls lib.a doesn't have are defined here.
+ */
+
+#define __LIBRARY__
+#include <unistd.h>
+#include <sys/time.h>
+
+_syscall0(int,getpid)
+_syscall2(int,gettimeofday,struct timeval *,tp,struct timezone *,tz)
+
+static inline int getpid_int80(void)
+{
+	long __res;
+
+	__asm__ volatile ("int $0x80"
+		:"=a" (__res)
+		:"0" (__NR_getpid));
+	return __res;
+}
+
+static void put(const char * s)
+{
+	const char * p = s;
+
+	while (*p)
+		p++;
+	write(1,s,p-s);
+}
+
+static void put_num(unsigned long n)
+{
+	char b[12];
+	int i = sizeof b;
+
+	b[--i] = 0;
+	do {
+		b[--i] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	put(b+i);
+}
+
+static unsigned long atoul(const char * s)
+{
+	unsigned long n = 0;
+
+	while (*s >= '0' && *s <= '9')
+		n = n*10 + *s++ - '0';
+	return n;
+}
+
+/* this wraps, but differences of less than an hour come out right */
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv,0);
+	return tv.tv_sec*1000000 + tv.tv_usec;
+}
+
+/* 'time' microseconds for 'calls' calls, as nanoseconds per call */
+static void report(const char * name, unsigned long time, unsigned long calls)
+{
+	put(name);
+	put(": ");
+	put_num(calls);
+	put(" calls in ");
+	put_num(time / 1000);
+	put(" ms, ");
+	put_num(time / calls * 1000 + time % calls * 1000 / calls);
+	put(" ns per call\n");
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned long calls = argc > 1 ? atoul(argv[1]) : 100000;
+	unsigned long i, start, time;
+	int pid = getpid();		/* the first call picks the entry */
+
+	if (!calls)
+		return 1;
+	start = usecs();
+	for (i = 0 ; i < calls ; i++)
+		if (getpid() != pid)
+			return 1;
+	time = usecs() - start;
+	report("__syscall_vector",time,calls);
+	start = usecs();
+	for (i = 0 ; i < calls ; i++)
+		if (getpid_int80() != pid)
+			return 1;
+	time = usecs() - start;
+	report("int $0x80",time,calls);
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ *  tools/tracedump.c
+ */
+
+/*
+ * tracedump decodes what the kernel tracepoints recorded (see
+ * include/linux/trace.h) into a timeline. It runs on the host:
+ *
+ *	gcc -o tracedump tracedump.c
+ *	tracedump [-k khz] [file]
+ *
+ * The input is the events just as trace(TRACE_READ,...) gave them, one
+ * after the other, written out by a program in the guest. 'khz' is what
+ * trace(TRACE_KHZ,...) said: with it the times are in microseconds,
+ * without it they are in TSC cycles, or jiffies on a cpu without a TSC.
+ *
+ * Syscall returns are matched up with the syscall the same pid made,
+ * and the end of a block request with its start, to give how long they
+ * took. A summary of the counts comes at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* a struct trace_event as the i386 kernel lays it out */
+#define EVENT_SIZE	20
+
+#define TR_SWITCH	1
+#define TR_SYSCALL	2
+#define TR_SYSRET	3
+#define TR_REQUEST	4
+#define TR_END_REQUEST	5
+#define TR_GETBLK_HIT	6
+#define TR_GETBLK_MISS	7
+#define TR_NO_PAGE	8
+#define TR_WP_PAGE	9
+#define NR_TYPES	10
+
+#define NR_PIDS		65536
+#define NR_PENDING	64	/* block requests in flight */
+
+struct event {
+	unsigned long long tsc;
+	int type, cpu, pid;
+	long a, b;
+};
+
+static const char * type_name[NR_TYPES] = {
+	"?", "switch", "syscall", "sysret", "request", "end_request",
+	"getblk_hit", "getblk_miss", "no_page", "wp_page"
+};
+
+static unsigned long khz = 0;
+
+static struct {
+	unsigned long long tsc;
+	long nr;
+	int valid;
+} in_syscall[NR_PIDS];
+
+static struct {
+	unsigned long long tsc;
+	long dev, sector;
+} pending[NR_PENDING];
+
+static unsigned long count[NR_TYPES];
+
+static unsigned long get32(const unsigned char * p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+static void decode(const unsigned char * p, struct event * e)
+{
+	e->tsc = get32(p) | ((unsigned long long) get32(p+4) << 32);
+	e->type = p[8];
+	e->cpu = p[9];
+	e->pid = p[10] | (p[11] << 8);
+	e->a = (long) (int) get32(p+12);
+	e->b = (long) (int) get32(p+16);
+}
+
+/* cycles to microseconds, if we know the rate */
+static double span(long long d)
+{
+	return khz ? d * 1000.0 / khz : (double) d;
+}
+
+static void request_start(struct event * e)
+{
+	int i;
+
+	for (i = 0 ; i < NR_PENDING ; i++)
+		if (!pending[i].tsc) {
+			pending[i].tsc = e->tsc;
+			pending[i].dev = e->a;
+			pending[i].sector = e->b;
+			return;
+		}
+}
+
+/* the time the request took, or -1 if we didn't see it start */
+static double request_end(struct event * e)
+{
+	double d;
+	int i;
+
+	for (i = 0 ; i < NR_PENDING ; i++)
+		if (pending[i].tsc && pending[i].dev == e->a &&
+		    (e->b == -1 || pending[i].sector == e->b)) {
+			d = span(e->tsc - pending[i].tsc);
+			pending[i].tsc = 0;
+			return d;
+		}
+	return -1;
+}
+
+static void print_event(struct event * e, unsigned long long start)
+{
+	double d;
+
+	printf("%14.3f %3d %5d  %-12s", span(e->tsc - start), e->cpu, e->pid,
+		e->type < NR_TYPES ? type_name[e->type] : "?");
+	switch (e->type) {
+		case TR_SWITCH:
+			printf("to %ld, state %ld", e->a, e->b);
+			break;
+		case TR_SYSCALL:
+			printf("%ld", e->a);
+			in_syscall[e->pid].tsc = e->tsc;
+			in_syscall[e->pid].nr = e->a;
+			in_syscall[e->pid].valid = 1;
+			break;
+		case TR_SYSRET:
+			printf("%ld", e->a);
+			if (in_syscall[e->pid].valid) {
+				printf(" from %ld, took %.3f",
+					in_syscall[e->pid].nr,
+					span(e->tsc - in_syscall[e->pid].tsc));
+				in_syscall[e->pid].valid = 0;
+			}
+			break;
+		case TR_REQUEST:
+			printf("dev %04lx sector %ld", e->a, e->b);
+			request_start(e);
+			break;
+		case TR_END_REQUEST:
+			if (e->b == -1)
+				printf("dev %04lx error", e->a);
+			else
+				printf("dev %04lx sector %ld", e->a, e->b);
+			if ((d = request_end(e)) >= 0)
+				printf(", took %.3f", d);
+			break;
+		case TR_GETBLK_HIT:
+		case TR_GETBLK_MISS:
+			printf("dev %04lx block %ld", e->a, e->b);
+			break;
+		case TR_NO_PAGE:
+		case TR_WP_PAGE:
+			printf("%08lx", (unsigned long) e->a);
+			break;
+	}
+	putchar('\n');
+}
+
+static void summary(void)
+{
+	unsigned long blk = count[TR_GETBLK_HIT] + count[TR_GETBLK_MISS];
+	int i;
+
+	printf("\n");
+	for (i = 1 ; i < NR_TYPES ; i++)
+		printf("%-12s %lu\n", type_name[i], count[i]);
+	if (blk)
+		printf("getblk hits  %lu%%\n", count[TR_GETBLK_HIT] * 100 / blk);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: tracedump [-k khz] [file]\n");
+	exit(1);
+}
+
+int main(int argc, char ** argv)
+{
+	unsigned char buf[EVENT_SIZE];
+	unsigned long long start = 0;
+	struct event e;
+	FILE * f = stdin;
+	int c, first = 1;
+
+	while ((c = getopt(argc, argv, "k:")) != -1) {
+		if (c != 'k')
+			usage();
+		khz = strtoul(optarg, NULL, 0);
+	}
+	if (optind < argc - 1)
+		usage();
+	if (optind == argc - 1 && !(f = fopen(argv[optind], "rb"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	printf("%14s %3s %5s  %s\n", khz ? "usecs" : "ticks", "cpu", "pid",
+		"event");
+	while (fread(buf, EVENT_SIZE, 1, f) == 1) {
+		decode(buf, &e);
+		if (first) {
+			start = e.tsc;
+			first = 0;
+		}
+		if (e.type < NR_TYPES)
+			count[e.type]++;
+		print_event(&e, start);
+	}
+	summary();
+	return 0;
+}